@@ -0,0 +1,132 @@
+// Album scan benchmark: builds a synthetic img:/YYYY/MM/DD tree and times
+// the discovery calls the detection loop makes on every poll.
+//
+//   bench_album [--files=10000] [--per-day=50] [--polls=50]
+
+#include <switch.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "album.hpp"
+#include "bench.hpp"
+#include "logger.hpp"
+
+namespace {
+constexpr std::string_view SUITE = "album";
+
+// Album file name for the n-th capture: one capture a minute, `perDay`
+// captures a day, starting 2020-01-01
+std::string capturePath(size_t n, size_t perDay) {
+    const size_t dayIndex = n / perDay;
+    const size_t minute = n % perDay;
+    const unsigned year = 2020 + static_cast<unsigned>(dayIndex / 336);
+    const unsigned month = 1 + static_cast<unsigned>(dayIndex / 28 % 12);
+    const unsigned day = 1 + static_cast<unsigned>(dayIndex % 28);
+
+    char path[96];
+    std::snprintf(path, sizeof(path),
+                  "img:/%04u/%02u/%02u/%04u%02u%02u%02u%02u%02u00-"
+                  "0100000000010000%016zX.jpg",
+                  year, month, day, year, month, day,
+                  static_cast<unsigned>(minute / 60 % 24),
+                  static_cast<unsigned>(minute % 60), 0u, n);
+    return path;
+}
+
+// Time `polls` calls of getNewAlbumItems(lastItem) and report the median
+// latency, the average allocations and directory reads per call. One poll
+// returns at most MAX_NEW_ALBUM_ITEMS items.
+void measurePolls(std::string_view metric, const std::string& lastItem,
+                  size_t polls, size_t newerItems) {
+    static AlbumItem items[MAX_NEW_ALBUM_ITEMS];
+    const size_t expected = std::min(newerItems, MAX_NEW_ALBUM_ITEMS);
+
+    std::vector<double> samples;
+    samples.reserve(polls);
+    const bench::AllocCounters before = bench::allocSnapshot();
+    const u64 dirReadsBefore = hostDirReadCount();
+    for (size_t i = 0; i < polls; ++i) {
+        const uint64_t start = bench::nowNs();
+        const auto count =
+            getNewAlbumItems(lastItem, items, MAX_NEW_ALBUM_ITEMS);
+        samples.push_back(static_cast<double>(bench::nowNs() - start) / 1e6);
+
+        if (!count || *count != expected) {
+            std::fprintf(stderr, "%.*s: expected %zu item(s), got %zu\n",
+                         static_cast<int>(metric.size()), metric.data(),
+                         expected, count ? *count : 0);
+        }
+    }
+    const bench::AllocCounters after = bench::allocSnapshot();
+    const u64 dirReads = hostDirReadCount() - dirReadsBefore;
+
+    std::string name(metric);
+    bench::report(SUITE, name + "_ms", bench::median(samples), "ms");
+    bench::report(SUITE, name + "_allocs",
+                  static_cast<double>(after.count - before.count) / polls,
+                  "allocs/poll");
+    bench::report(SUITE, name + "_alloc_bytes",
+                  static_cast<double>(after.bytes - before.bytes) / polls,
+                  "bytes/poll");
+    bench::report(SUITE, name + "_dir_reads",
+                  static_cast<double>(dirReads) / polls, "reads/poll");
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t files = bench::option(argc, argv, "files", 10'000);
+    const size_t perDay = bench::option(argc, argv, "per-day", 50);
+    const size_t polls = bench::option(argc, argv, "polls", 50);
+
+    if (!bench::enterSandbox("album")) return 1;
+    Logger::get().setLevel(LogLevel::WARN);
+
+    std::vector<std::string> paths;
+    paths.reserve(files + 2);
+    for (size_t n = 0; n < files; ++n) {
+        paths.push_back(capturePath(n, perDay));
+        bench::writeFile(paths.back(), 0);
+    }
+    bench::report(SUITE, "files", static_cast<double>(files), "files");
+
+    // Startup: find the newest item
+    {
+        const uint64_t start = bench::nowNs();
+        const auto last = getLastAlbumItem();
+        bench::report(SUITE, "last_item_ms",
+                      static_cast<double>(bench::nowNs() - start) / 1e6, "ms");
+        if (!last || *last != paths.back()) {
+            std::fprintf(stderr, "getLastAlbumItem() returned wrong item\n");
+        }
+    }
+
+    // Steady state: nothing new (the first call builds the branch index)
+    measurePolls("idle_poll", paths.back(), polls, 0);
+
+    // A capture in the newest day directory
+    paths.push_back(capturePath(files, perDay));
+    bench::writeFile(paths.back(), 0);
+    measurePolls("new_item_poll", paths[files - 1], 1, 1);
+
+    // A capture that opens a new day directory
+    paths.push_back(capturePath(files + perDay, perDay));
+    bench::writeFile(paths.back(), 0);
+    measurePolls("new_day_poll", paths[files], 1, 1);
+
+    // A capture that replaces a deleted one, leaving every count as it was
+    std::remove(paths.back().c_str());
+    paths.back() = capturePath(files + perDay + 1, perDay);
+    bench::writeFile(paths.back(), 0);
+    measurePolls("replaced_poll", capturePath(files + perDay, perDay), 1, 1);
+
+    // Worst case: resuming from the oldest item walks the whole tree (and
+    // returns the oldest MAX_NEW_ALBUM_ITEMS of it)
+    measurePolls("full_walk", paths.front(), 3, paths.size() - 1);
+
+    Logger::get().close();
+    bench::leaveSandbox();
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Upload journal benchmark: record cost with a long offline backlog, the
+// size the journal settles at, and a replay that has to resume all of it
+// (including a video preview, which must not move the high-water mark).
+// The resumed files are then parked and taken back out, as while a channel
+// is paused.
+//
+//   bench_journal [--backlog=2000]
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+#include "bench.hpp"
+#include "journal.hpp"
+#include "logger.hpp"
+#include "project.h"
+#include "utils.hpp"
+
+namespace {
+constexpr std::string_view SUITE = "journal";
+constexpr const char* JOURNAL_PATH = "sdmc:/config/" APP_TITLE "/journal.txt";
+constexpr const char* PREVIEW_PATH =
+    "sdmc:/config/" APP_TITLE
+    "/previews/2024011512000000-0100000000010000ABCDEF0123456789.jpg";
+
+std::string capturePath(size_t n) {
+    char path[96];
+    std::snprintf(path, sizeof(path),
+                  "img:/2024/01/15/2024011512%04zu00-"
+                  "0100000000010000ABCDEF0123456789.jpg",
+                  n % 10000);
+    return path;
+}
+
+size_t g_resumed = 0;
+bool g_previewResumed = false;
+
+bool countResumed(const JournalEntry& entry) {
+    g_resumed++;
+    if (std::string_view(entry.filePath) == PREVIEW_PATH) {
+        g_previewResumed = true;
+    }
+    return true;
+}
+
+size_t g_unparked = 0;
+bool g_attemptsKept = true;
+
+// Takes up to `g_unparkRoom` files, like a retry queue with that much room
+size_t g_unparkRoom = 0;
+
+ChannelMask countUnparked(const JournalEntry& entry) {
+    if (g_unparkRoom == 0) return 0;
+    g_unparkRoom--;
+    g_unparked++;
+    g_attemptsKept &= entry.attempts[0] == 2;
+    return entry.pending;
+}
+
+// Park the unfinished files of a `backlog`, then take them back out
+bool checkUnpark(size_t backlog, size_t unfinished) {
+    constexpr uint8_t attempts[UPLOAD_CHANNEL_COUNT] = {2, 0, 0};
+    bool parked = journalPark(PREVIEW_PATH, 1, attempts);
+    for (size_t i = backlog / 2; i < backlog; ++i) {
+        parked &= journalPark(capturePath(i).c_str(), 1, attempts);
+    }
+
+    // A probe takes a single file, a full retry queue none
+    g_unparkRoom = SIZE_MAX;
+    ChannelMask left = journalUnpark(1, 1, countUnparked);
+    const bool probed = g_unparked == 1 && left == 1;
+    g_unparkRoom = 0;
+    left = journalUnpark(1, SIZE_MAX, countUnparked);
+    const bool held = g_unparked == 1 && left == 1;
+
+    g_unparkRoom = SIZE_MAX;
+    left = journalUnpark(1, SIZE_MAX, countUnparked);
+    if (!parked || !probed || !held || left != 0 ||
+        g_unparked != unfinished || !g_attemptsKept) {
+        std::fprintf(stderr, "unparked %zu of %zu parked entries\n",
+                     g_unparked, unfinished);
+        return false;
+    }
+    return true;
+}
+
+// Journal `backlog` files, finish the older half, then exit like a reboot
+void recordBacklog(size_t backlog) {
+    std::string highWaterMark;
+    journalReplay(countResumed, highWaterMark);
+
+    uint64_t start = bench::nowNs();
+    for (size_t i = 0; i < backlog; ++i) {
+        journalEnqueue(capturePath(i).c_str(), 1, 1);
+    }
+    // Outlives the compactions below
+    journalEnqueueDerived(PREVIEW_PATH, 1, 1);
+    bench::report(SUITE, "enqueue_us_per_op",
+                  static_cast<double>(bench::nowNs() - start) / 1000 / backlog,
+                  "us/op");
+
+    start = bench::nowNs();
+    for (size_t i = 0; i < backlog / 2; ++i) {
+        journalComplete(capturePath(i).c_str(), 1);
+    }
+    bench::report(SUITE, "complete_us_per_op",
+                  static_cast<double>(bench::nowNs() - start) / 1000 /
+                      (backlog / 2),
+                  "us/op");
+    bench::report(SUITE, "bytes_after_backlog",
+                  static_cast<double>(filesize(JOURNAL_PATH)), "bytes");
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t backlog = bench::option(argc, argv, "backlog", 2000);
+
+    if (!bench::enterSandbox("journal")) return 1;
+    Logger::get().setLevel(LogLevel::WARN);
+
+    // The journal keeps its state in statics, so the session before the
+    // "reboot" runs in a child process
+    const pid_t child = fork();
+    if (child == 0) {
+        recordBacklog(backlog);
+        Logger::get().close();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    std::string highWaterMark;
+    g_resumed = 0;
+    const uint64_t start = bench::nowNs();
+    const size_t unfinished = journalReplay(countResumed, highWaterMark);
+    bench::report(SUITE, "replay_ms",
+                  static_cast<double>(bench::nowNs() - start) / 1e6, "ms");
+    bench::report(SUITE, "resumed", static_cast<double>(g_resumed),
+                  "entries");
+
+    int result = 0;
+    const size_t expected = backlog - backlog / 2 + 1;
+    if (unfinished != expected || g_resumed != expected) {
+        std::fprintf(stderr, "resumed %zu of %zu unfinished entries\n",
+                     g_resumed, expected);
+        result = 1;
+    }
+    if (!g_previewResumed) {
+        std::fprintf(stderr, "preview was not resumed\n");
+        result = 1;
+    }
+    if (highWaterMark != capturePath(backlog - 1)) {
+        std::fprintf(stderr, "high-water mark %s, expected %s\n",
+                     highWaterMark.c_str(), capturePath(backlog - 1).c_str());
+        result = 1;
+    }
+    if (!checkUnpark(backlog, expected)) result = 1;
+
+    Logger::get().close();
+    bench::leaveSandbox();
+    return result;
+}
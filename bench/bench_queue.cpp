@@ -0,0 +1,111 @@
+// Upload queue benchmark: enqueue/dequeue cost in RAM, once a burst
+// overflows to the spill files on SD, and with a backlog that never drains
+// (the size the spill file settles at).
+//
+//   bench_queue [--tasks=100000] [--burst=200]
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "bench.hpp"
+#include "logger.hpp"
+#include "project.h"
+#include "queue.hpp"
+#include "utils.hpp"
+
+namespace {
+constexpr std::string_view SUITE = "queue";
+
+const char* const IMAGE_PATH =
+    "img:/2024/01/15/2024011512000000-0100000000010000ABCDEF0123456789.jpg";
+constexpr const char* SPILL_PATH =
+    "sdmc:/config/" APP_TITLE "/queue_images.bin";
+
+// Push `burst` screenshots, then drain them in batches
+void measureBurst(std::string_view metric, size_t burst, size_t rounds) {
+    UploadTask tasks[MAX_BATCH_SIZE];
+    size_t ops = 0;
+    const bench::AllocCounters before = bench::allocSnapshot();
+    const uint64_t start = bench::nowNs();
+
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < burst; ++i) {
+            if (!queueAdd(IMAGE_PATH, 1, 1, static_cast<uint32_t>(round + 1),
+                          0)) {
+                std::fprintf(stderr, "queueAdd() failed at %zu\n", i);
+                return;
+            }
+        }
+        size_t drained = 0;
+        while (const size_t count = queueGetBatch(tasks, MAX_BATCH_SIZE, true)) {
+            drained += count;
+        }
+        if (drained != burst) {
+            std::fprintf(stderr, "drained %zu of %zu\n", drained, burst);
+        }
+        ops += burst * 2;
+    }
+
+    const double elapsedNs = static_cast<double>(bench::nowNs() - start);
+    const bench::AllocCounters after = bench::allocSnapshot();
+
+    std::string name(metric);
+    bench::report(SUITE, name + "_ns_per_op", elapsedNs / ops, "ns/op");
+    bench::report(SUITE, name + "_allocs_per_op",
+                  static_cast<double>(after.count - before.count) / ops,
+                  "allocs/op");
+}
+// Keep `backlog` screenshots queued while `ops` more go through one at a
+// time, so the spill file is never drained
+void measureSteady(size_t backlog, size_t ops) {
+    for (size_t i = 0; i < backlog; ++i) {
+        if (!queueAdd(IMAGE_PATH, 1, 1, static_cast<uint32_t>(i), 0)) {
+            std::fprintf(stderr, "queueAdd() failed at %zu\n", i);
+            return;
+        }
+    }
+
+    UploadTask task;
+    const uint64_t start = bench::nowNs();
+    for (size_t i = 0; i < ops; ++i) {
+        if (!queueAdd(IMAGE_PATH, 1, 1, static_cast<uint32_t>(backlog + i),
+                      0) ||
+            queueGetBatch(&task, 1, true) != 1 || task.pollId != i) {
+            std::fprintf(stderr, "steady state broke at %zu\n", i);
+            return;
+        }
+    }
+    bench::report(SUITE, "steady_ns_per_op",
+                  static_cast<double>(bench::nowNs() - start) / (ops * 2),
+                  "ns/op");
+    bench::report(SUITE, "steady_spill_bytes",
+                  static_cast<double>(filesize(SPILL_PATH)), "bytes");
+
+    UploadTask tasks[MAX_BATCH_SIZE];
+    while (queueGetBatch(tasks, MAX_BATCH_SIZE, true) > 0) {
+    }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t tasks = bench::option(argc, argv, "tasks", 100'000);
+    const size_t burst = bench::option(argc, argv, "burst", 200);
+
+    if (!bench::enterSandbox("queue")) return 1;
+    Logger::get().setLevel(LogLevel::WARN);
+    queueInit();
+
+    // Fits the RAM ring of the image lane
+    measureBurst("ram", IMAGE_QUEUE_SIZE, tasks / (IMAGE_QUEUE_SIZE * 2));
+
+    // Overflows to the spill file
+    measureBurst("spill", burst, std::max<size_t>(1, tasks / 100 / burst));
+
+    // Never drains, so the spill file is never emptied either
+    measureSteady(burst, tasks / 10);
+
+    Logger::get().close();
+    bench::leaveSandbox();
+    return 0;
+}
@@ -0,0 +1,229 @@
+// Upload pipeline benchmark: sends synthetic captures through the real
+// upload code (shared reader, curl multi fan-out, batching) to a local mock
+// HTTP sink standing in for Telegram, Discord and ntfy.
+//
+// A last pass drops every other request on a reused connection, so curl has
+// to rewind each kind of request body and send it again.
+//
+//   bench_upload [--screenshots=20] [--screenshot-kb=512] [--videos=2]
+//                [--video-mb=16]
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "config.hpp"
+#include "logger.hpp"
+#include "mock_sink.hpp"
+#include "upload.hpp"
+
+namespace {
+constexpr std::string_view SUITE = "upload";
+
+// curl allocator hooks, so its allocations count towards allocs/upload
+void* curlMalloc(size_t size) {
+    bench::allocRecord(size);
+    return std::malloc(size);
+}
+void* curlRealloc(void* p, size_t size) {
+    bench::allocRecord(size);
+    return std::realloc(p, size);
+}
+char* curlStrdup(const char* s) {
+    bench::allocRecord(std::strlen(s) + 1);
+    return ::strdup(s);
+}
+void* curlCalloc(size_t count, size_t size) {
+    bench::allocRecord(count * size);
+    return std::calloc(count, size);
+}
+
+std::string configFor(uint16_t port) {
+    const std::string url = "http://127.0.0.1:" + std::to_string(port);
+    return "[general]\n"
+           "telegram = true\n"
+           "ntfy = true\n"
+           "discord = true\n"
+           "log_level = warn\n"
+           "[telegram]\n"
+           "bot_token = bench\n"
+           "chat_id = 1\n"
+           "api_url = " + url + "\n"
+           "[ntfy]\n"
+           "url = " + url + "\n"
+           "topic = bench\n"
+           "upload_movies = true\n"
+           "[discord]\n"
+           "bot_token = bench\n"
+           "channel_id = 1\n"
+           "upload_movies = true\n"
+           "api_url = " + url + "\n";
+}
+
+std::string capturePath(size_t n, const char* extension) {
+    char path[96];
+    std::snprintf(path, sizeof(path),
+                  "img:/2024/01/15/20240115120000%02zu-"
+                  "0100000000010000ABCDEF01234567%02zu.%s",
+                  n % 100, n % 100, extension);
+    return path;
+}
+
+struct Run {
+    uint64_t startNs;
+    uint64_t sinkBytes;
+    uint64_t sinkRequests;
+    bench::AllocCounters allocs;
+};
+
+Run begin(const bench::MockSink& sink) {
+    return {bench::nowNs(), sink.bodyBytes(), sink.requests(),
+            bench::allocSnapshot()};
+}
+
+// Report throughput of the request bodies the sink received and the cost
+// per uploaded file
+void finish(std::string_view metric, const Run& run,
+            const bench::MockSink& sink, size_t files) {
+    const double seconds = static_cast<double>(bench::nowNs() - run.startNs) /
+                           1e9;
+    const bench::AllocCounters allocs = bench::allocSnapshot();
+    const double megabytes =
+        static_cast<double>(sink.bodyBytes() - run.sinkBytes) / 1024 / 1024;
+
+    std::string name(metric);
+    bench::report(SUITE, name + "_throughput", megabytes / seconds, "MB/s");
+    bench::report(SUITE, name + "_ms_per_file", seconds * 1000 / files,
+                  "ms/file");
+    bench::report(SUITE, name + "_requests",
+                  static_cast<double>(sink.requests() - run.sinkRequests),
+                  "requests");
+    bench::report(SUITE, name + "_allocs_per_file",
+                  static_cast<double>(allocs.count - run.allocs.count) / files,
+                  "allocs/file");
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t screenshots = bench::option(argc, argv, "screenshots", 20);
+    const size_t screenshotKb = bench::option(argc, argv, "screenshot-kb", 512);
+    const size_t videos = bench::option(argc, argv, "videos", 2);
+    const size_t videoMb = bench::option(argc, argv, "video-mb", 16);
+
+    if (!bench::enterSandbox("upload")) return 1;
+    bench::silenceStdout();
+    curl_global_init_mem(CURL_GLOBAL_DEFAULT, curlMalloc, std::free,
+                         curlRealloc, curlStrdup, curlCalloc);
+    uploadInit();
+
+    bench::MockSink sink;
+    if (!sink.start()) {
+        std::fprintf(stderr, "Could not start the mock sink\n");
+        return 1;
+    }
+    bench::writeConfig(configFor(sink.port()));
+    if (!Config::load()) {
+        std::fprintf(stderr, "Config::load() failed\n");
+        return 1;
+    }
+    Logger::get().setLevel(LogLevel::WARN);
+
+    std::vector<std::string> images;
+    for (size_t i = 0; i < screenshots; ++i) {
+        images.push_back(capturePath(i, "jpg"));
+        bench::writeFile(images.back(), screenshotKb * 1024);
+    }
+    std::vector<std::string> movies;
+    for (size_t i = 0; i < videos; ++i) {
+        movies.push_back(capturePath(screenshots + i, "mp4"));
+        bench::writeFile(movies.back(), videoMb * 1024 * 1024);
+    }
+
+    const ChannelMask channels = uploadEnabledChannels();
+    int result = 0;
+
+    // One fan-out request per screenshot
+    Run run = begin(sink);
+    for (const std::string& path : images) {
+        if (uploadToChannels(path, screenshotKb * 1024, channels) != channels) {
+            std::fprintf(stderr, "upload of %s failed\n", path.c_str());
+            result = 1;
+        }
+    }
+    finish("screenshot", run, sink, images.size());
+
+    // The same screenshots as media groups / multi-attachment messages
+    run = begin(sink);
+    for (size_t first = 0; first < images.size(); first += MAX_BATCH_SIZE) {
+        BatchItem items[MAX_BATCH_SIZE];
+        const size_t count = std::min(MAX_BATCH_SIZE, images.size() - first);
+        for (size_t i = 0; i < count; ++i) {
+            items[i] = {images[first + i].c_str(), screenshotKb * 1024,
+                        channels, 0};
+        }
+        uploadBatch(items, count);
+    }
+    finish("batch", run, sink, images.size());
+
+    // Large files: exercises the shared read window and pausing
+    run = begin(sink);
+    for (const std::string& path : movies) {
+        if (uploadToChannels(path, videoMb * 1024 * 1024, channels) !=
+            channels) {
+            std::fprintf(stderr, "upload of %s failed\n", path.c_str());
+            result = 1;
+        }
+    }
+    finish("video", run, sink, movies.size());
+
+    // Resent bodies: a form with one file, a form with several, a PUT, and
+    // a video whose read window has long moved on
+    sink.dropReused(2);
+    const uint64_t droppedBefore = sink.dropped();
+    run = begin(sink);
+    const size_t rewindImages = std::min<size_t>(images.size(), 4);
+    for (size_t i = 0; i < rewindImages; ++i) {
+        if (uploadToChannels(images[i], screenshotKb * 1024, channels) !=
+            channels) {
+            std::fprintf(stderr, "resend of %s failed\n", images[i].c_str());
+            result = 1;
+        }
+    }
+    BatchItem items[MAX_BATCH_SIZE];
+    const size_t batchCount = std::min(MAX_BATCH_SIZE, images.size());
+    for (size_t i = 0; i < batchCount; ++i) {
+        items[i] = {images[i].c_str(), screenshotKb * 1024, channels, 0};
+    }
+    uploadBatch(items, batchCount);
+    for (size_t i = 0; i < batchCount; ++i) {
+        if (items[i].succeeded != channels) {
+            std::fprintf(stderr, "resend of batch item %s failed\n",
+                         images[i].c_str());
+            result = 1;
+        }
+    }
+    if (!movies.empty() &&
+        uploadToChannels(movies[0], videoMb * 1024 * 1024, channels) !=
+            channels) {
+        std::fprintf(stderr, "resend of %s failed\n", movies[0].c_str());
+        result = 1;
+    }
+    finish("rewind", run, sink, rewindImages + batchCount + 1);
+    bench::report(SUITE, "rewind_dropped",
+                  static_cast<double>(sink.dropped() - droppedBefore),
+                  "requests");
+    sink.dropReused(0);
+
+    uploadCleanup();
+    sink.stop();
+    curl_global_cleanup();
+    Logger::get().close();
+    bench::leaveSandbox();
+    return result;
+}
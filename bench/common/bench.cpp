@@ -0,0 +1,183 @@
+#include "bench.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+
+#include "project.h"
+
+namespace {
+std::atomic<uint64_t> g_allocCount{0};
+std::atomic<uint64_t> g_allocBytes{0};
+std::string g_sandbox;
+FILE* g_reportOut = stdout;
+
+void* countedAlloc(size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+}  // namespace
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return countedAlloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+void* operator new[](size_t size, std::align_val_t align,
+                     const std::nothrow_t&) noexcept {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::aligned_alloc(static_cast<size_t>(align),
+                              (size + static_cast<size_t>(align) - 1) &
+                                  ~(static_cast<size_t>(align) - 1));
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+
+namespace bench {
+
+AllocCounters allocSnapshot() noexcept {
+    return {g_allocCount.load(std::memory_order_relaxed),
+            g_allocBytes.load(std::memory_order_relaxed)};
+}
+
+void allocRecord(size_t bytes) noexcept {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+bool enterSandbox(std::string_view name) {
+    const char* tmp = std::getenv("TMPDIR");
+    std::string pattern = tmp && *tmp ? tmp : "/tmp";
+    pattern += "/nxsu-";
+    pattern += name;
+    pattern += "-XXXXXX";
+
+    if (!mkdtemp(pattern.data())) {
+        std::perror("mkdtemp");
+        return false;
+    }
+    g_sandbox = pattern;
+    if (chdir(g_sandbox.c_str()) != 0) {
+        std::perror("chdir");
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories("img:", ec);
+    std::filesystem::create_directories("sdmc:/config/" APP_TITLE, ec);
+    return !ec;
+}
+
+void leaveSandbox() {
+    if (g_sandbox.empty() || std::getenv("BENCH_KEEP_SANDBOX")) return;
+
+    [[maybe_unused]] const int rc = chdir("/");
+    std::error_code ec;
+    std::filesystem::remove_all(g_sandbox, ec);
+    g_sandbox.clear();
+}
+
+void writeConfig(std::string_view contents) {
+    FILE* f = std::fopen("sdmc:/config/" APP_TITLE "/config.ini", "w");
+    if (!f) return;
+    std::fwrite(contents.data(), 1, contents.size(), f);
+    std::fclose(f);
+}
+
+void writeFile(const std::string& path, size_t size) {
+    std::error_code ec;
+    std::filesystem::create_directories(
+        std::filesystem::path(path).parent_path(), ec);
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return;
+    char block[4096];
+    for (size_t i = 0; i < sizeof(block); ++i) {
+        block[i] = static_cast<char>(i * 31);
+    }
+    for (size_t written = 0; written < size;) {
+        const size_t n = std::min(sizeof(block), size - written);
+        std::fwrite(block, 1, n, f);
+        written += n;
+    }
+    std::fclose(f);
+}
+
+uint64_t nowNs() noexcept {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+double median(std::vector<double>& samples) {
+    if (samples.empty()) return 0;
+    const auto mid = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), mid, samples.end());
+    return *mid;
+}
+
+void silenceStdout() {
+    std::fflush(stdout);
+    const int original = dup(STDOUT_FILENO);
+    const int devNull = open("/dev/null", O_WRONLY);
+    if (original < 0 || devNull < 0) return;
+
+    if (FILE* out = fdopen(original, "w")) {
+        g_reportOut = out;
+        dup2(devNull, STDOUT_FILENO);
+    }
+    close(devNull);
+}
+
+void report(std::string_view suite, std::string_view metric, double value,
+            std::string_view unit) {
+    std::fprintf(g_reportOut, "%.*s.%.*s %.3f %.*s\n",
+                 static_cast<int>(suite.size()), suite.data(),
+                 static_cast<int>(metric.size()), metric.data(), value,
+                 static_cast<int>(unit.size()), unit.data());
+    std::fflush(g_reportOut);
+}
+
+size_t option(int argc, char** argv, std::string_view name, size_t fallback) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (!arg.starts_with("--")) continue;
+        arg.remove_prefix(2);
+        if (!arg.starts_with(name) || arg.size() <= name.size() ||
+            arg[name.size()] != '=') {
+            continue;
+        }
+        arg.remove_prefix(name.size() + 1);
+
+        size_t value = 0;
+        const auto [ptr, ec] =
+            std::from_chars(arg.data(), arg.data() + arg.size(), value);
+        if (ec == std::errc() && value > 0) return value;
+    }
+    return fallback;
+}
+
+}  // namespace bench
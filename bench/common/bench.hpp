@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Shared helpers of the host benchmarks. Every bench runs in a fresh
+// sandbox directory that stands in for the Switch devices: "img:" holds the
+// synthetic album and "sdmc:/config/<app>" the config, log and queue files.
+
+namespace bench {
+
+// Heap allocations made through operator new (and, for the upload bench,
+// by curl) since the process started
+struct AllocCounters {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+[[nodiscard]] AllocCounters allocSnapshot() noexcept;
+
+// Count an allocation made outside operator new (curl's allocator hooks)
+void allocRecord(size_t bytes) noexcept;
+
+// Create and enter a sandbox under $TMPDIR. Returns false on failure.
+[[nodiscard]] bool enterSandbox(std::string_view name);
+
+// Remove the sandbox again (best effort)
+void leaveSandbox();
+
+// Write sdmc:/config/<app>/config.ini
+void writeConfig(std::string_view contents);
+
+// Create a file of the given size filled with a repeating pattern
+void writeFile(const std::string& path, size_t size);
+
+// Monotonic clock in nanoseconds
+[[nodiscard]] uint64_t nowNs() noexcept;
+
+// Median of a set of samples (the vector is reordered)
+[[nodiscard]] double median(std::vector<double>& samples);
+
+// Send stdout to /dev/null (curl writes response bodies there) while
+// report() keeps printing to the original stdout
+void silenceStdout();
+
+// Print one result line: "<suite>.<metric> <value> <unit>"
+void report(std::string_view suite, std::string_view metric, double value,
+            std::string_view unit);
+
+// Read a positive integer option "--name=value" from argv
+[[nodiscard]] size_t option(int argc, char** argv, std::string_view name,
+                            size_t fallback);
+
+}  // namespace bench
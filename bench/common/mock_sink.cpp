@@ -0,0 +1,212 @@
+#include "mock_sink.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench {
+namespace {
+constexpr std::string_view RESPONSE =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 11\r\n"
+    "\r\n"
+    "{\"ok\":true}";
+
+// Buffered reader over a connected socket. Reads give up on EOF or once
+// the sink is stopping.
+class Connection {
+   public:
+    Connection(int fd, const std::atomic<bool>& running)
+        : m_fd(fd), m_running(running) {}
+
+    // Read a line terminated by CRLF (without it). False on EOF.
+    bool readLine(std::string& line) {
+        line.clear();
+        while (true) {
+            if (m_pos == m_len && !refill()) return false;
+            const char c = m_buffer[m_pos++];
+            if (c == '\n') {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            line.push_back(c);
+        }
+    }
+
+    // Discard `bytes` bytes. False on EOF.
+    bool skip(uint64_t bytes) {
+        while (bytes > 0) {
+            if (m_pos == m_len && !refill()) return false;
+            const size_t n =
+                static_cast<size_t>(std::min<uint64_t>(bytes, m_len - m_pos));
+            m_pos += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+    bool write(std::string_view data) {
+        while (!data.empty()) {
+            const ssize_t n = ::send(m_fd, data.data(), data.size(), 0);
+            if (n <= 0) return false;
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+   private:
+    bool refill() {
+        ssize_t n;
+        do {
+            n = ::recv(m_fd, m_buffer, sizeof(m_buffer), 0);
+        } while (n < 0 && (errno == EAGAIN || errno == EINTR) && m_running);
+        if (n <= 0) return false;
+        m_pos = 0;
+        m_len = static_cast<size_t>(n);
+        return true;
+    }
+
+    int m_fd;
+    const std::atomic<bool>& m_running;
+    char m_buffer[64 * 1024];
+    size_t m_pos{0};
+    size_t m_len{0};
+};
+
+bool headerIs(std::string_view line, std::string_view name) {
+    return line.size() > name.size() && line[name.size()] == ':' &&
+           strncasecmp(line.data(), name.data(), name.size()) == 0;
+}
+
+std::string_view headerValue(std::string_view line, std::string_view name) {
+    std::string_view value = line.substr(name.size() + 1);
+    while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+    return value;
+}
+}  // namespace
+
+bool MockSink::start() {
+    m_listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenFd < 0) return false;
+
+    const int one = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t length = sizeof(addr);
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+            0 ||
+        ::listen(m_listenFd, 16) != 0 ||
+        ::getsockname(m_listenFd, reinterpret_cast<sockaddr*>(&addr),
+                      &length) != 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+
+    m_port = ntohs(addr.sin_port);
+    m_running = true;
+    m_thread = std::thread([this] { acceptLoop(); });
+    return true;
+}
+
+void MockSink::stop() {
+    if (!m_running.exchange(false)) return;
+    m_thread.join();
+    ::close(m_listenFd);
+    m_listenFd = -1;
+}
+
+void MockSink::acceptLoop() {
+    std::vector<std::thread> workers;
+    while (m_running) {
+        pollfd pfd{m_listenFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) continue;
+
+        const int fd = ::accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        workers.emplace_back([this, fd] { serve(fd); });
+    }
+    for (std::thread& worker : workers) worker.join();
+}
+
+void MockSink::serve(int fd) {
+    // Don't block shutdown on idle keep-alive connections
+    timeval timeout{0, 200'000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    Connection conn(fd, m_running);
+    std::string line;
+    uint64_t served = 0;  // Requests answered on this connection
+    while (conn.readLine(line)) {
+        if (line.empty()) continue;
+
+        uint64_t contentLength = 0;
+        bool chunked = false;
+        bool expectContinue = false;
+        while (conn.readLine(line) && !line.empty()) {
+            if (headerIs(line, "Content-Length")) {
+                contentLength = std::strtoull(
+                    std::string(headerValue(line, "Content-Length")).c_str(),
+                    nullptr, 10);
+            } else if (headerIs(line, "Transfer-Encoding")) {
+                chunked = headerValue(line, "Transfer-Encoding") == "chunked";
+            } else if (headerIs(line, "Expect")) {
+                expectContinue = true;
+            }
+        }
+
+        // A dead connection does not answer Expect either; curl sends the
+        // body once its 100-continue wait times out
+        const uint64_t dropEvery = m_dropEvery;
+        const bool drop = served > 0 && dropEvery > 0 &&
+                          ++m_reusedRequests % dropEvery == 0;
+        if (expectContinue && !drop &&
+            !conn.write("HTTP/1.1 100 Continue\r\n\r\n")) {
+            break;
+        }
+
+        uint64_t received = 0;
+        bool ok = true;
+        if (chunked) {
+            while ((ok = conn.readLine(line))) {
+                const uint64_t size = std::strtoull(line.c_str(), nullptr, 16);
+                ok = conn.skip(size) && conn.readLine(line);
+                received += size;
+                if (!ok || size == 0) break;
+            }
+        } else {
+            ok = conn.skip(contentLength);
+            received = contentLength;
+        }
+        if (!ok) break;
+
+        if (drop) {
+            ++m_dropped;
+            break;
+        }
+
+        ++served;
+        m_bodyBytes += received;
+        ++m_requests;
+        if (!conn.write(RESPONSE)) break;
+    }
+    ::close(fd);
+}
+
+}  // namespace bench
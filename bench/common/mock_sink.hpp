@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace bench {
+
+// Minimal HTTP/1.1 server on 127.0.0.1 that accepts any request, discards
+// the body and answers 200 with a small JSON body. Stands in for Telegram,
+// Discord and ntfy so the upload path can be timed without a network.
+class MockSink {
+   public:
+    MockSink() = default;
+    ~MockSink() { stop(); }
+
+    MockSink(const MockSink&) = delete;
+    MockSink& operator=(const MockSink&) = delete;
+
+    // Listen on an ephemeral port. Returns false on failure.
+    [[nodiscard]] bool start();
+    void stop();
+
+    [[nodiscard]] uint16_t port() const noexcept { return m_port; }
+    [[nodiscard]] uint64_t requests() const noexcept { return m_requests; }
+    [[nodiscard]] uint64_t bodyBytes() const noexcept { return m_bodyBytes; }
+    [[nodiscard]] uint64_t dropped() const noexcept { return m_dropped; }
+
+    // Close the connection instead of answering every `every`-th request
+    // that arrives on a reused connection (0 answers all), the way a server
+    // drops an idle keep-alive connection. curl resends such a request on
+    // a fresh connection, which needs the body rewound.
+    void dropReused(uint64_t every) noexcept { m_dropEvery = every; }
+
+   private:
+    void acceptLoop();
+    void serve(int fd);
+
+    int m_listenFd{-1};
+    uint16_t m_port{0};
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_requests{0};
+    std::atomic<uint64_t> m_bodyBytes{0};
+    std::atomic<uint64_t> m_dropEvery{0};
+    std::atomic<uint64_t> m_reusedRequests{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::thread m_thread;
+};
+
+}  // namespace bench
@@ -0,0 +1,140 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <switch.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+FsFileSystem g_devices[] = {{"img"}, {"sdmc"}};
+u64 g_dirReads = 0;
+}  // namespace
+
+Result condvarWaitTimeout(CondVar* c, Mutex* m, u64 timeoutNs) {
+    const auto timeout = std::chrono::nanoseconds(
+        std::min<u64>(timeoutNs, 3'600'000'000'000ULL));
+    return c->cv.wait_for(m->m, timeout) == std::cv_status::timeout ? 1 : 0;
+}
+
+u64 armGetSystemTick() {
+    return static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void svcSleepThread(s64 ns) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+FsFileSystem* fsdevGetDeviceFileSystem(const char* name) {
+    const size_t length = std::strcspn(name, ":");
+    for (FsFileSystem& fs : g_devices) {
+        if (std::strlen(fs.device) == length &&
+            std::strncmp(fs.device, name, length) == 0) {
+            return &fs;
+        }
+    }
+    return nullptr;
+}
+
+Result fsFsOpenDirectory(FsFileSystem* fs, const char* path, u32 mode,
+                         FsDir* out) {
+    std::snprintf(out->path, sizeof(out->path), "%s:%s", fs->device, path);
+    out->mode = mode;
+    out->handle = nullptr;
+    struct stat st;
+    return stat(out->path, &st) == 0 && S_ISDIR(st.st_mode)
+               ? 0
+               : HOST_RESULT_UNAVAILABLE;
+}
+
+Result fsDirGetEntryCount(FsDir* dir, s64* out) {
+    DIR* d = opendir(dir->path);
+    if (!d) return HOST_RESULT_UNAVAILABLE;
+
+    s64 count = 0;
+    while (const dirent* entry = readdir(d)) {
+        if (std::strcmp(entry->d_name, ".") == 0 ||
+            std::strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        const bool isDir = entry->d_type == DT_DIR;
+        if ((isDir && (dir->mode & FsDirOpenMode_ReadDirs)) ||
+            (!isDir && (dir->mode & FsDirOpenMode_ReadFiles))) {
+            ++count;
+        }
+    }
+    closedir(d);
+    *out = count;
+    return 0;
+}
+
+Result fsDirRead(FsDir* dir, s64* totalEntries, size_t maxEntries,
+                 FsDirectoryEntry* entries) {
+    ++g_dirReads;
+    if (!dir->handle) dir->handle = opendir(dir->path);
+    if (!dir->handle) return HOST_RESULT_UNAVAILABLE;
+
+    size_t count = 0;
+    while (count < maxEntries) {
+        const dirent* entry = readdir(dir->handle);
+        if (!entry) break;
+        if (std::strcmp(entry->d_name, ".") == 0 ||
+            std::strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        const bool isDir = entry->d_type == DT_DIR;
+        if ((isDir && !(dir->mode & FsDirOpenMode_ReadDirs)) ||
+            (!isDir && !(dir->mode & FsDirOpenMode_ReadFiles))) {
+            continue;
+        }
+
+        FsDirectoryEntry& out = entries[count++];
+        std::snprintf(out.name, sizeof(out.name), "%s", entry->d_name);
+        out.type = isDir ? FsDirEntryType_Dir : FsDirEntryType_File;
+        out.file_size = 0;
+    }
+    *totalEntries = static_cast<s64>(count);
+    return 0;
+}
+
+void fsDirClose(FsDir* dir) {
+    if (dir->handle) closedir(dir->handle);
+    dir->handle = nullptr;
+}
+
+u64 hostDirReadCount() { return g_dirReads; }
+
+Result fsFsGetEntryType(FsFileSystem* fs, const char* path,
+                        FsDirEntryType* out) {
+    char fullPath[512];
+    std::snprintf(fullPath, sizeof(fullPath), "%s:%s", fs->device, path);
+    struct stat st;
+    if (stat(fullPath, &st) != 0) return HOST_RESULT_UNAVAILABLE;
+    *out = S_ISDIR(st.st_mode) ? FsDirEntryType_Dir : FsDirEntryType_File;
+    return 0;
+}
+
+Result fsFsOpenFile(FsFileSystem* fs, const char* path, u32, FsFile* out) {
+    char fullPath[512];
+    std::snprintf(fullPath, sizeof(fullPath), "%s:%s", fs->device, path);
+    out->fd = open(fullPath, O_RDONLY);
+    return out->fd >= 0 ? 0 : HOST_RESULT_UNAVAILABLE;
+}
+
+Result fsFileRead(FsFile* file, s64 offset, void* buffer, u64 size, u32,
+                  u64* bytesRead) {
+    const ssize_t n = pread(file->fd, buffer, size, offset);
+    if (n < 0) return HOST_RESULT_UNAVAILABLE;
+    *bytesRead = static_cast<u64>(n);
+    return 0;
+}
+
+void fsFileClose(FsFile* file) {
+    if (file->fd >= 0) close(file->fd);
+    file->fd = -1;
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+// Host stand-in for the parts of libnx the benchmarked sources use. Paths of
+// fsdev devices ("img:/...", "sdmc:/...") are plain relative paths on Linux,
+// so the benches run inside a sandbox directory holding "img:" and "sdmc:".
+// Ticks are nanoseconds of the steady clock.
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef u32 Result;
+
+#define R_FAILED(res) ((res) != 0)
+#define R_SUCCEEDED(res) ((res) == 0)
+
+// Generic failure for services that do not exist on the host
+constexpr Result HOST_RESULT_UNAVAILABLE = 0xDEAD;
+
+// Synchronization
+struct Mutex {
+    std::mutex m;
+};
+struct RMutex {
+    std::recursive_mutex m;
+};
+struct CondVar {
+    std::condition_variable_any cv;
+};
+
+inline void mutexInit(Mutex*) {}
+inline void mutexLock(Mutex* m) { m->m.lock(); }
+inline void mutexUnlock(Mutex* m) { m->m.unlock(); }
+inline void rmutexInit(RMutex*) {}
+inline void rmutexLock(RMutex* m) { m->m.lock(); }
+inline void rmutexUnlock(RMutex* m) { m->m.unlock(); }
+inline void condvarInit(CondVar*) {}
+Result condvarWaitTimeout(CondVar* c, Mutex* m, u64 timeoutNs);
+inline Result condvarWakeOne(CondVar* c) {
+    c->cv.notify_one();
+    return 0;
+}
+
+// Time
+u64 armGetSystemTick();
+inline u64 armTicksToNs(u64 tick) { return tick; }
+inline u64 armNsToTicks(u64 ns) { return ns; }
+void svcSleepThread(s64 ns);
+
+// Filesystem
+struct FsFileSystem {
+    const char* device;
+};
+struct FsDir {
+    char path[512];
+    u32 mode;
+    DIR* handle;  // Opened by the first fsDirRead
+};
+struct FsFile {
+    int fd;
+};
+
+enum FsDirOpenMode : u32 {
+    FsDirOpenMode_ReadDirs = 1,
+    FsDirOpenMode_ReadFiles = 2,
+    FsDirOpenMode_NoFileSize = 0x80000000,
+};
+enum FsDirEntryType : s8 {
+    FsDirEntryType_Dir = 0,
+    FsDirEntryType_File = 1,
+};
+struct FsDirectoryEntry {
+    char name[0x301];
+    u8 pad[3];
+    s8 type;
+    u8 pad2[3];
+    s64 file_size;
+};
+enum FsOpenMode : u32 {
+    FsOpenMode_Read = 1,
+};
+enum FsReadOption : u32 {
+    FsReadOption_None = 0,
+};
+
+// Accepts a device name or any path on it ("img", "img:/2024/...")
+FsFileSystem* fsdevGetDeviceFileSystem(const char* name);
+Result fsFsOpenDirectory(FsFileSystem* fs, const char* path, u32 mode,
+                         FsDir* out);
+Result fsDirGetEntryCount(FsDir* dir, s64* out);
+Result fsDirRead(FsDir* dir, s64* totalEntries, size_t maxEntries,
+                 FsDirectoryEntry* entries);
+void fsDirClose(FsDir* dir);
+Result fsFsGetEntryType(FsFileSystem* fs, const char* path,
+                        FsDirEntryType* out);
+// Host only: fsDirRead calls so far, each an IPC round trip on the console
+u64 hostDirReadCount();
+Result fsFsOpenFile(FsFileSystem* fs, const char* path, u32 mode,
+                    FsFile* out);
+Result fsFileRead(FsFile* file, s64 offset, void* buffer, u64 size,
+                  u32 option, u64* bytesRead);
+void fsFileClose(FsFile* file);
+
+// Album service: unavailable, so album.cpp stays on the fs walk
+enum CapsAlbumStorage {
+    CapsAlbumStorage_Nand = 0,
+    CapsAlbumStorage_Sd = 1,
+};
+enum CapsAlbumFileContents {
+    CapsAlbumFileContents_ScreenShot = 0,
+    CapsAlbumFileContents_Movie = 1,
+    CapsAlbumFileContents_ExtraScreenShot = 2,
+    CapsAlbumFileContents_ExtraMovie = 3,
+};
+struct CapsAlbumFileDateTime {
+    u16 year;
+    u8 month;
+    u8 day;
+    u8 hour;
+    u8 minute;
+    u8 second;
+    u8 id;
+};
+struct CapsAlbumFileId {
+    u64 application_id;
+    CapsAlbumFileDateTime datetime;
+    u8 storage;
+    u8 content;
+    u8 field_x12;
+    u8 unk_x13;
+    u8 pad_x14[4];
+};
+struct CapsAlbumEntry {
+    u64 size;
+    CapsAlbumFileId file_id;
+};
+
+inline Result capsaGetAlbumFileCount(CapsAlbumStorage, u64*) {
+    return HOST_RESULT_UNAVAILABLE;
+}
+inline Result capsaGetAlbumFileList(CapsAlbumStorage, u64*, CapsAlbumEntry*,
+                                    u64) {
+    return HOST_RESULT_UNAVAILABLE;
+}
+struct CapsAlbumDateTime {
+    u16 year;
+    u8 month;
+    u8 day;
+    u8 hour;
+    u8 minute;
+    u8 second;
+    u8 unk_x7;
+};
+inline Result capsaGetAlbumFileList3(CapsAlbumStorage, s64*, CapsAlbumEntry*,
+                                     s64, const CapsAlbumDateTime*,
+                                     const CapsAlbumDateTime*) {
+    return HOST_RESULT_UNAVAILABLE;
+}
+struct CapsOverlayThumbnailData {
+    CapsAlbumFileId file_id;
+    u64 size;
+};
+inline Result capsaGetLastOverlayMovieThumbnail(CapsOverlayThumbnailData*,
+                                                void*, u64) {
+    return HOST_RESULT_UNAVAILABLE;
+}
+inline Result capsaLoadAlbumFileThumbnail(const CapsAlbumFileId*, u64*, void*,
+                                          u64) {
+    return HOST_RESULT_UNAVAILABLE;
+}
+
+// No foreground title and no capture button on the host
+struct Event {
+    u32 unused;
+};
+inline Result pmdmntGetApplicationProcessId(u64*) {
+    return HOST_RESULT_UNAVAILABLE;
+}
+inline Result hidsysInitialize() { return HOST_RESULT_UNAVAILABLE; }
+inline void hidsysExit() {}
+inline Result hidsysAcquireCaptureButtonEventHandle(Event*, bool) {
+    return HOST_RESULT_UNAVAILABLE;
+}
+inline Result eventWait(Event*, u64) { return HOST_RESULT_UNAVAILABLE; }
+inline void eventClose(Event*) {}
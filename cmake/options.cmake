@@ -9,4 +9,19 @@ option(ENABLE_LTO "Enable Link Time Optimization (LTO)" ON)
 
 # Enable time-related functions (get_time, time initialization)
 # Set to ON to enable time functionality, OFF to disable
-option(ENABLE_TIME_FUNCTIONS "Enable time-related functions" OFF)
\ No newline at end of file
+option(ENABLE_TIME_FUNCTIONS "Enable time-related functions" OFF)
+
+# Count heap use per subsystem by wrapping the newlib allocator at link time
+# (the memory log lines then include per-subsystem allocation counts)
+option(ENABLE_HEAP_STATS "Enable per-subsystem heap accounting" ON)
+
+# Re-encode screenshots with libjpeg (switch-libjpeg-turbo) before upload when
+# transcode_quality is set in config.ini. Without it screenshots are always
+# sent as they are
+option(ENABLE_TRANSCODE "Enable JPEG re-encoding of screenshots" ON)
+
+# Lowest log level compiled into the binary (debug, info, warn, error).
+# Messages below it are removed at compile time regardless of log_level
+# in config.ini, e.g. set to info for release builds
+set(LOG_LEVEL_MIN "debug" CACHE STRING "Lowest log level compiled in")
+set_property(CACHE LOG_LEVEL_MIN PROPERTY STRINGS debug info warn error)
\ No newline at end of file
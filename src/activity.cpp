@@ -0,0 +1,110 @@
+#include "activity.hpp"
+
+#include <switch.h>
+
+#include <algorithm>
+
+#include "logger.hpp"
+
+namespace {
+Event g_captureEvent;
+bool g_captureEventActive = false;
+}  // namespace
+
+bool isApplicationRunning() noexcept {
+    u64 pid = 0;
+    return R_SUCCEEDED(pmdmntGetApplicationProcessId(&pid));
+}
+
+bool captureEventInit() noexcept {
+    if (g_captureEventActive) return true;
+
+    Result rc = hidsysInitialize();
+    if (R_FAILED(rc)) {
+        LOG_ERROR() << "hidsysInitialize() failed: " << rc << endl;
+        return false;
+    }
+
+    rc = hidsysAcquireCaptureButtonEventHandle(&g_captureEvent, true);
+    if (R_FAILED(rc)) {
+        LOG_ERROR() << "hidsysAcquireCaptureButtonEventHandle() failed: "
+                    << rc << endl;
+        hidsysExit();
+        return false;
+    }
+
+    g_captureEventActive = true;
+    return true;
+}
+
+void captureEventExit() noexcept {
+    if (!g_captureEventActive) return;
+
+    eventClose(&g_captureEvent);
+    hidsysExit();
+    g_captureEventActive = false;
+}
+
+bool captureEventWait(uint64_t timeoutNs) noexcept {
+    if (!g_captureEventActive) {
+        svcSleepThread(static_cast<s64>(timeoutNs));
+        return false;
+    }
+    // Auto-clear event: a successful wait consumes the press
+    return R_SUCCEEDED(eventWait(&g_captureEvent, timeoutNs));
+}
+
+void PollScheduler::configure(int intervalSeconds, int maxIntervalSeconds,
+                              bool eventDriven) noexcept {
+    m_minNs = static_cast<uint64_t>(intervalSeconds) * 1'000'000'000ULL;
+    m_maxNs = static_cast<uint64_t>(maxIntervalSeconds) * 1'000'000'000ULL;
+    m_currentNs = m_minNs;
+    m_lastCaptureTick = armGetSystemTick();
+    m_settleEndTick = 0;
+    m_eventDriven = eventDriven;
+}
+
+void PollScheduler::onCaptureButton() noexcept {
+    m_settleEndTick = armGetSystemTick() + armNsToTicks(CAPTURE_SETTLE_NS);
+}
+
+uint64_t PollScheduler::next(bool foundItems, bool appRunning) noexcept {
+    const uint64_t now = armGetSystemTick();
+    if (foundItems) {
+        m_lastCaptureTick = now;
+    }
+
+    const uint64_t previousNs = m_currentNs;
+    m_currentNs = m_eventDriven ? nextEventDriven(now, foundItems)
+                                : nextPolled(now, appRunning);
+
+    if (m_currentNs != previousNs) {
+        LOG_DEBUG() << "Check interval now " << m_currentNs / 1'000'000ULL
+                    << " ms" << endl;
+    }
+    return m_currentNs;
+}
+
+uint64_t PollScheduler::nextPolled(uint64_t now, bool appRunning) noexcept {
+    const bool recentCapture =
+        armTicksToNs(now - m_lastCaptureTick) < CAPTURE_ACTIVE_WINDOW_NS;
+    if (recentCapture || appRunning) {
+        return m_minNs;
+    }
+    // Idle: back off exponentially, capped at the ceiling
+    return std::min(m_currentNs * 2, m_maxNs);
+}
+
+uint64_t PollScheduler::nextEventDriven(uint64_t now,
+                                        bool foundItems) noexcept {
+    // One press saves one capture, so stop rechecking once it is found
+    if (foundItems || (m_settleEndTick != 0 && now >= m_settleEndTick)) {
+        m_settleEndTick = 0;
+    }
+    if (m_settleEndTick != 0) {
+        return CAPTURE_RECHECK_NS;
+    }
+    // Safety net for captures the button event does not report (e.g. saved
+    // by a game or copied in over USB)
+    return m_maxNs;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+// Foreground state, capture-button notifications and the adaptive detection
+// interval. Only used by the detection loop on the main thread.
+
+// Time the loop keeps polling fast after a new capture, since captures tend
+// to come in bursts
+constexpr uint64_t CAPTURE_ACTIVE_WINDOW_NS = 60'000'000'000ULL;
+
+// After a capture button press the album is rechecked this often until the
+// new item shows up or CAPTURE_SETTLE_NS has passed. The album service needs
+// a moment to write a screenshot and a few seconds to encode a recording.
+constexpr uint64_t CAPTURE_RECHECK_NS = 500'000'000ULL;
+constexpr uint64_t CAPTURE_SETTLE_NS = 10'000'000'000ULL;
+
+// True while a title (game or application) is running in the foreground
+[[nodiscard]] bool isApplicationRunning() noexcept;
+
+// Subscribe to capture button presses (detection_mode = event). Returns
+// false if hidsys is unavailable. Safe to call when already subscribed.
+[[nodiscard]] bool captureEventInit() noexcept;
+void captureEventExit() noexcept;
+
+// Sleep up to timeoutNs, waking early on a capture button press. Returns
+// true on a press; a plain sleep when not subscribed.
+[[nodiscard]] bool captureEventWait(uint64_t timeoutNs) noexcept;
+
+// Picks the sleep between album checks. When polling: the configured check
+// interval right after a capture or while a title is running, doubling
+// toward the idle ceiling otherwise. When event driven: quick rechecks after
+// a button press, and the idle ceiling as a safety net in between.
+class PollScheduler {
+   public:
+    // Set the fast and idle intervals (seconds) and start polling fast
+    void configure(int intervalSeconds, int maxIntervalSeconds,
+                   bool eventDriven) noexcept;
+
+    // The capture button was pressed; recheck until the item is saved
+    void onCaptureButton() noexcept;
+
+    // Record the outcome of a check and return how long to sleep (ns)
+    [[nodiscard]] uint64_t next(bool foundItems, bool appRunning) noexcept;
+
+   private:
+    [[nodiscard]] uint64_t nextPolled(uint64_t now, bool appRunning) noexcept;
+    [[nodiscard]] uint64_t nextEventDriven(uint64_t now,
+                                           bool foundItems) noexcept;
+
+    uint64_t m_minNs{0};
+    uint64_t m_maxNs{0};
+    uint64_t m_currentNs{0};
+    uint64_t m_lastCaptureTick{0};
+    uint64_t m_settleEndTick{0};  // 0 when not waiting for a pressed capture
+    bool m_eventDriven{false};
+};
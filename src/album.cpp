@@ -1,270 +1,817 @@
 #include "album.hpp"
 
+#include <switch.h>
+
 #include <algorithm>
-#include <filesystem>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
 #include <ranges>
 #include <string>
 #include <string_view>
-#include <vector>
 
 #ifdef ENABLE_TIME_FUNCTIONS
 #include <chrono>
 #endif
 
+#include "config.hpp"
 #include "logger.hpp"
 
-namespace fs = std::filesystem;
-
 namespace {
-constexpr std::string_view ALBUM_PATH = "img:/";
+constexpr const char* ALBUM_DEVICE = "img";
+
+// "/YYYY/MM/DD" and "YYYYMMDD", sized for any u16 values so snprintf cannot
+// truncate them
+constexpr size_t DATE_PATH_SIZE = sizeof("/65535/65535/65535");
+constexpr size_t DATE_KEY_SIZE = sizeof("655356553565535");
+
+// Snapshot of the newest branch of the album tree (root -> year -> month ->
+// day) together with the entry count of every directory on it and the
+// newest file of the day. New captures always land somewhere on this
+// branch, so a poll in which none of the four counts changed and the day
+// still ends with the same file can return without walking the tree. The
+// name catches a capture that replaced a deleted one.
+struct AlbumIndex {
+    bool valid{false};
+    char dayPath[DATE_PATH_SIZE]{};  // "/YYYY/MM/DD" in the image filesystem
+    s64 counts[4]{};     // root, year, month, day
+    char dayNewest[ALBUM_NAME_MAX + 1]{};  // Newest file name in dayPath
+    char newest[ALBUM_PATH_MAX]{};  // Newest item known when counted
+};
+
+// Length of the root, year, month and day prefixes of AlbumIndex::dayPath
+constexpr size_t INDEX_PATH_LENGTHS[4] = {1, 5, 8, 11};
+
+AlbumIndex g_index;
+
+// capsa backend state. The listing buffer is static so it never competes
+// with curl for heap; a date range with more entries is narrowed until its
+// listing fits.
+constexpr size_t CAPS_LIST_CAPACITY = 256;  // 8KB
+constexpr size_t CAPS_KEY_LENGTH = 16;      // "YYYYMMDDHHMMSSII"
+// Formatted keys have room for any field values, so snprintf cannot
+// truncate them
+constexpr size_t CAPS_KEY_SIZE = sizeof("65535255255255255255255");
+// File names continue with "-" and 32 hex digits derived from the title
+constexpr size_t CAPS_TITLE_LENGTH = 32;
+constexpr size_t CAPS_TITLE_CACHE_SIZE = 8;
+// Latest capture time a listing asks for
+constexpr CapsAlbumDateTime CAPS_RANGE_END = {9999, 12, 31, 23, 59, 59, 0};
+
+CapsAlbumStorage g_storage = CapsAlbumStorage_Sd;
+CapsAlbumEntry g_capsEntries[CAPS_LIST_CAPACITY];
+u16 g_capsFresh[CAPS_LIST_CAPACITY];  // Listing indices newer than lastItem
+
+// Title part of the file names of recently seen titles, so their captures
+// can be named without listing the day directory
+struct CapsTitle {
+    u64 applicationId;
+    char name[CAPS_TITLE_LENGTH];  // Not terminated
+    bool valid;
+};
+CapsTitle g_capsTitles[CAPS_TITLE_CACHE_SIZE];
+size_t g_capsTitleNext = 0;  // Slot replaced by the next new title
+
+// The overlay returns the last recording's id along with a raw 96x54 RGBA
+// image; album thumbnails are 320x180 JPEGs well below the buffer size
+constexpr size_t OVERLAY_IMAGE_SIZE = 96 * 54 * 4;
+constexpr size_t THUMBNAIL_BUFFER_SIZE = 0x8000;  // 32KB
+
+// Directory listings are read into this buffer, one fsDirRead IPC per
+// batch. Entries are 0x310 bytes, so 32 of them cost 24.5KB of .bss and
+// read most day directories in one or two calls (a full walk of 10000
+// captures takes 630 reads instead of 2876 with batches of 4). Listings
+// never nest, so one buffer serves all.
+constexpr size_t DIR_READ_BATCH = 32;
+FsDirectoryEntry g_dirEntries[DIR_READ_BATCH];
+
+// Year, month or day subdirectories of one album directory. Two-digit names
+// have at most 100 values; years beyond that many are ignored.
+constexpr size_t MAX_DATE_DIRS = 100;
+struct DateDirs {
+    u16 values[MAX_DATE_DIRS];
+    size_t count;
+};
 
 constexpr bool isDigitsOnly(std::string_view str) noexcept {
     return std::ranges::all_of(str,
                                [](char c) { return c >= '0' && c <= '9'; });
 }
 
-// Use template parameter to avoid lambda overhead, directly compare filename
-// strings
-template <size_t ExpectedLen>
-[[nodiscard]] fs::path findMaxDir(const fs::path& dir) noexcept {
-    fs::path max_path;
-    std::string max_filename;
-
-    for (const auto& entry : fs::directory_iterator(dir)) {
-        if (!entry.is_directory()) continue;
-
-        const auto& p = entry.path();
-        auto filename = p.filename().string();
-
-        if (filename.length() != ExpectedLen || !isDigitsOnly(filename))
-            continue;
+// Call visit(name, isDirectory) for every entry of a directory of the image
+// filesystem. Returns false if the directory cannot be opened.
+template <typename Visit>
+bool forEachEntry(FsFileSystem* fs, const char* path, u32 mode,
+                  Visit&& visit) noexcept {
+    FsDir dir;
+    if (R_FAILED(fsFsOpenDirectory(fs, path, mode | FsDirOpenMode_NoFileSize,
+                                   &dir))) {
+        return false;
+    }
 
-        if (filename > max_filename) {
-            max_filename = std::move(filename);
-            max_path = p;
+    s64 read = 0;
+    while (R_SUCCEEDED(fsDirRead(&dir, &read, DIR_READ_BATCH, g_dirEntries)) &&
+           read > 0) {
+        for (s64 i = 0; i < read; ++i) {
+            const FsDirectoryEntry& entry = g_dirEntries[i];
+            visit(std::string_view(entry.name),
+                  entry.type == FsDirEntryType_Dir);
         }
     }
+    fsDirClose(&dir);
+    return true;
+}
 
-    return max_path;
+// Collect the numeric subdirectories with `digits`-character names that are
+// >= minValue, in ascending order
+void listDateDirs(FsFileSystem* fs, const char* path, size_t digits,
+                  u16 minValue, DateDirs& out) noexcept {
+    out.count = 0;
+    forEachEntry(fs, path, FsDirOpenMode_ReadDirs,
+                 [&](std::string_view name, bool isDirectory) {
+                     if (!isDirectory || name.size() != digits ||
+                         !isDigitsOnly(name) || out.count == MAX_DATE_DIRS) {
+                         return;
+                     }
+                     u16 value = 0;
+                     std::from_chars(name.data(), name.data() + name.size(),
+                                     value);
+                     if (value >= minValue) out.values[out.count++] = value;
+                 });
+    std::sort(out.values, out.values + out.count);
 }
 
-[[nodiscard]] fs::path findMaxFileInDir(const fs::path& dir) noexcept {
-    fs::path max_path;
-    std::string max_filename;
+// "/YYYY", "/YYYY/MM" or "/YYYY/MM/DD" for the first `levels` values
+void formatDatePath(char (&out)[DATE_PATH_SIZE], const u16 (&date)[3],
+                    size_t levels) noexcept {
+    const unsigned year = date[0];
+    const unsigned month = date[1];
+    const unsigned day = date[2];
+    switch (levels) {
+        case 1:
+            std::snprintf(out, sizeof(out), "/%04u", year);
+            break;
+        case 2:
+            std::snprintf(out, sizeof(out), "/%04u/%02u", year, month);
+            break;
+        default:
+            std::snprintf(out, sizeof(out), "/%04u/%02u/%02u", year, month,
+                          day);
+            break;
+    }
+}
 
-    for (const auto& entry : fs::directory_iterator(dir)) {
-        if (!entry.is_regular_file()) continue;
+// Find the newest year, month and day directory. Returns how many of the
+// three levels were found; `path` holds the deepest one found (or "/").
+size_t findNewestDay(FsFileSystem* fs, u16 (&date)[3],
+                     char (&path)[DATE_PATH_SIZE]) noexcept {
+    std::snprintf(path, sizeof(path), "/");
+    for (size_t level = 0; level < 3; ++level) {
+        DateDirs dirs;
+        listDateDirs(fs, path, level == 0 ? 4 : 2, 0, dirs);
+        if (dirs.count == 0) return level;
+
+        date[level] = dirs.values[dirs.count - 1];
+        formatDatePath(path, date, level + 1);
+    }
+    return 3;
+}
 
-        const auto& p = entry.path();
-        auto filename = p.filename().string();
+// Newest (largest) file name in a day directory
+bool findNewestFile(FsFileSystem* fs, const char* dayPath,
+                    char (&name)[ALBUM_NAME_MAX + 1]) noexcept {
+    name[0] = '\0';
+    forEachEntry(fs, dayPath, FsDirOpenMode_ReadFiles,
+                 [&](std::string_view entry, bool isDirectory) {
+                     if (isDirectory || entry.size() > ALBUM_NAME_MAX) return;
+                     if (entry > std::string_view(name)) {
+                         std::memcpy(name, entry.data(), entry.size());
+                         name[entry.size()] = '\0';
+                     }
+                 });
+    return name[0] != '\0';
+}
 
-        if (filename > max_filename) {
-            max_filename = std::move(filename);
-            max_path = p;
-        }
-    }
+void makeItem(AlbumItem& item, const u16 (&date)[3],
+              std::string_view name) noexcept {
+    static_assert(sizeof(item.day) < DATE_KEY_SIZE);
+    char day[DATE_KEY_SIZE];
+    std::snprintf(day, sizeof(day), "%04u%02u%02u", date[0], date[1],
+                  date[2]);
+    std::memcpy(item.day, day, sizeof(item.day));
+    std::memcpy(item.name, name.data(), name.size());
+    item.name[name.size()] = '\0';
+}
 
-    return max_path;
+bool itemLess(const AlbumItem& a, const AlbumItem& b) noexcept {
+    const int day = std::memcmp(a.day, b.day, sizeof(a.day));
+    return day != 0 ? day < 0 : std::strcmp(a.name, b.name) < 0;
 }
 
-// Collect all files in a directory that are newer than lastPath
-void collectFilesNewerThan(const fs::path& dir, std::string_view lastPath,
-                           std::vector<std::string>& result) noexcept {
-    for (const auto& entry : fs::directory_iterator(dir)) {
-        if (!entry.is_regular_file()) continue;
+// Keeps the `capacity` oldest items offered to it in a caller-provided
+// array, as a max-heap until finish() sorts them
+class OldestItems {
+   public:
+    OldestItems(AlbumItem* items, size_t capacity) noexcept
+        : m_items(items), m_capacity(capacity) {}
+
+    void offer(const u16 (&date)[3], std::string_view name) noexcept {
+        if (m_capacity == 0) {
+            m_truncated = true;
+            return;
+        }
 
-        const auto& p = entry.path();
-        auto fullPath = p.string();
+        AlbumItem item;
+        makeItem(item, date, name);
+        if (m_count < m_capacity) {
+            m_items[m_count++] = item;
+            std::push_heap(m_items, m_items + m_count, itemLess);
+            return;
+        }
 
-        // Compare full path strings - files are sorted by path
-        if (fullPath > lastPath) {
-            result.push_back(std::move(fullPath));
+        // Full: replace the newest kept item if this one is older
+        m_truncated = true;
+        if (itemLess(item, m_items[0])) {
+            std::pop_heap(m_items, m_items + m_count, itemLess);
+            m_items[m_count - 1] = item;
+            std::push_heap(m_items, m_items + m_count, itemLess);
         }
     }
-}
-
-// Find all directories in dir with expected length that are >= minDirName
-template <size_t ExpectedLen>
-void findDirsGreaterOrEqual(const fs::path& dir, std::string_view minDirName,
-                            std::vector<fs::path>& result) noexcept {
-    for (const auto& entry : fs::directory_iterator(dir)) {
-        if (!entry.is_directory()) continue;
 
-        const auto& p = entry.path();
-        auto filename = p.filename().string();
+    // Sort the kept items oldest first and return how many there are
+    size_t finish() noexcept {
+        std::sort_heap(m_items, m_items + m_count, itemLess);
+        return m_count;
+    }
 
-        if (filename.length() != ExpectedLen || !isDigitsOnly(filename))
-            continue;
+    // True if newer items had to be left for the next poll
+    [[nodiscard]] bool truncated() const noexcept { return m_truncated; }
+
+   private:
+    AlbumItem* m_items;
+    size_t m_capacity;
+    size_t m_count{0};
+    bool m_truncated{false};
+};
+
+// Offer every file of a day directory whose path sorts after lastItem
+void collectDay(FsFileSystem* fs, const u16 (&date)[3],
+                std::string_view lastItem, OldestItems& items) noexcept {
+    char dayPath[DATE_PATH_SIZE];
+    formatDatePath(dayPath, date, 3);
+
+    // "img:/YYYY/MM/DD/" followed by each file name
+    char path[ALBUM_PATH_MAX];
+    const int prefixLength =
+        std::snprintf(path, sizeof(path), "%s:%s/", ALBUM_DEVICE, dayPath);
+
+    forEachEntry(fs, dayPath, FsDirOpenMode_ReadFiles,
+                 [&](std::string_view name, bool isDirectory) {
+                     if (isDirectory || name.size() > ALBUM_NAME_MAX) return;
+
+                     std::memcpy(path + prefixLength, name.data(), name.size());
+                     const std::string_view fullPath(
+                         path, prefixLength + name.size());
+                     if (fullPath > lastItem) items.offer(date, name);
+                 });
+}
 
-        if (filename >= minDirName) {
-            result.push_back(p);
-        }
+// Parse the year, month and day directory of an album path
+bool parseItemDate(std::string_view path, u16 (&date)[3]) noexcept {
+    // Format: img:/YYYY/MM/DD/filename
+    if (path.starts_with("img:/")) path.remove_prefix(5);
+    if (path.size() < 10 || path[4] != '/' || path[7] != '/') return false;
+
+    const std::string_view parts[3] = {path.substr(0, 4), path.substr(5, 2),
+                                       path.substr(8, 2)};
+    for (size_t i = 0; i < 3; ++i) {
+        if (!isDigitsOnly(parts[i])) return false;
+        std::from_chars(parts[i].data(), parts[i].data() + parts[i].size(),
+                        date[i]);
     }
+    return true;
 }
 
-// Collect all files from a day directory that are newer than lastItem
-void collectFromDayDir(const fs::path& dayDir, std::string_view lastItem,
-                       std::vector<std::string>& result) noexcept {
-    collectFilesNewerThan(dayDir, lastItem, result);
+// Entry count of a directory of the image filesystem (a single, cheap IPC
+// round-trip instead of listing it), or -1 if it cannot be read
+s64 dirEntryCount(FsFileSystem* fs, const char* path) noexcept {
+    FsDir dir;
+    const u32 mode = FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles |
+                     FsDirOpenMode_NoFileSize;
+    if (R_FAILED(fsFsOpenDirectory(fs, path, mode, &dir))) return -1;
+
+    s64 count = -1;
+    if (R_FAILED(fsDirGetEntryCount(&dir, &count))) count = -1;
+    fsDirClose(&dir);
+    return count;
 }
 
-// Collect all files from a month directory
-// If isMinMonth is true, only collect from days >= minDay
-void collectFromMonthDir(const fs::path& monthDir, std::string_view lastItem,
-                         std::string_view minDay, bool isMinMonth,
-                         std::vector<std::string>& result) noexcept {
-    std::vector<fs::path> days;
-    findDirsGreaterOrEqual<2>(monthDir, isMinMonth ? minDay : "", days);
-
-    for (const auto& dayDir : days) {
-        auto dayName = dayDir.filename().string();
-        if (isMinMonth && dayName == minDay) {
-            // This is the minimum day, only collect files newer than lastItem
-            collectFromDayDir(dayDir, lastItem, result);
-        } else {
-            // This is a newer day, collect all files
-            collectFilesNewerThan(dayDir, "", result);
-        }
+// Read the entry counts of every directory on the indexed branch
+bool readIndexCounts(const AlbumIndex& index, s64 (&counts)[4]) noexcept {
+    FsFileSystem* fs = fsdevGetDeviceFileSystem(ALBUM_DEVICE);
+    if (!fs) return false;
+
+    char path[sizeof(index.dayPath)];
+    for (size_t i = 0; i < 4; ++i) {
+        const size_t len = INDEX_PATH_LENGTHS[i];
+        std::memcpy(path, index.dayPath, len);
+        path[len] = '\0';
+        counts[i] = dirEntryCount(fs, path);
+        if (counts[i] < 0) return false;
     }
+    return true;
 }
 
-// Collect all files from a year directory
-// If isMinYear is true, only collect from months >= minMonth
-void collectFromYearDir(const fs::path& yearDir, std::string_view lastItem,
-                        std::string_view minMonth, std::string_view minDay,
-                        bool isMinYear,
-                        std::vector<std::string>& result) noexcept {
-    std::vector<fs::path> months;
-    findDirsGreaterOrEqual<2>(yearDir, isMinYear ? minMonth : "", months);
-
-    for (const auto& monthDir : months) {
-        auto monthName = monthDir.filename().string();
-        if (isMinYear && monthName == minMonth) {
-            // This is the minimum month
-            collectFromMonthDir(monthDir, lastItem, minDay, true, result);
-        } else {
-            // This is a newer month, collect all files
-            collectFromMonthDir(monthDir, lastItem, "", false, result);
-        }
+// True if the indexed branch is unchanged and nothing newer than lastItem
+// can exist
+bool indexIsCurrent(std::string_view lastItem) noexcept {
+    if (!g_index.valid || lastItem < g_index.newest) return false;
+
+    s64 counts[4];
+    if (!readIndexCounts(g_index, counts) ||
+        !std::ranges::equal(counts, g_index.counts)) {
+        return false;
     }
+
+    // Same counts, but the day may have traded a deleted capture for a new
+    // one
+    FsFileSystem* fs = fsdevGetDeviceFileSystem(ALBUM_DEVICE);
+    char name[ALBUM_NAME_MAX + 1];
+    return fs && findNewestFile(fs, g_index.dayPath, name) &&
+           std::strcmp(name, g_index.dayNewest) == 0;
+}
+
+// Rebuild the index from the current newest year/month/day directories.
+// Must run before the walk so captures landing during it change the counts
+// and force another walk on the next poll.
+void rebuildIndex(FsFileSystem* fs, std::string_view lastItem) noexcept {
+    g_index.valid = false;
+
+    u16 date[3];
+    if (findNewestDay(fs, date, g_index.dayPath) < 3) return;
+    if (!readIndexCounts(g_index, g_index.counts) ||
+        !findNewestFile(fs, g_index.dayPath, g_index.dayNewest)) {
+        return;
+    }
+
+    const size_t length = std::min(lastItem.size(), ALBUM_PATH_MAX - 1);
+    std::memcpy(g_index.newest, lastItem.data(), length);
+    g_index.newest[length] = '\0';
+    g_index.valid = true;
 }
 
 }  // namespace
 
+void AlbumItem::path(char (&out)[ALBUM_PATH_MAX]) const noexcept {
+    std::snprintf(out, sizeof(out), "%s:/%.4s/%.2s/%.2s/%s", ALBUM_DEVICE, day,
+                  day + 4, day + 6, name);
+}
+
 std::expected<std::string, std::string> getLastAlbumItem() {
 #ifdef ENABLE_TIME_FUNCTIONS
     const auto startTime = std::chrono::high_resolution_clock::now();
 #endif
 
-    // 1. Find Year (Length 4, Directory)
-    const fs::path year = findMaxDir<4>(ALBUM_PATH);
-    if (year.empty())
-        return std::unexpected("No valid year directories in img:/");
-
-    // 2. Find Month (Length 2, Directory)
-    const fs::path month = findMaxDir<2>(year);
-    if (month.empty())
-        return std::unexpected("No valid month directories in " +
-                               year.string());
-
-    // 3. Find Day (Length 2, Directory)
-    const fs::path day = findMaxDir<2>(month);
-    if (day.empty())
-        return std::unexpected("No valid day directories in " + month.string());
+    FsFileSystem* fs = fsdevGetDeviceFileSystem(ALBUM_DEVICE);
+    if (!fs) return std::unexpected("Image filesystem is not mounted");
+
+    // 1-3. Find the newest year (4 digits), month and day (2 digits)
+    u16 date[3];
+    char dayPath[DATE_PATH_SIZE];
+    switch (findNewestDay(fs, date, dayPath)) {
+        case 0:
+            return std::unexpected("No valid year directories in img:/");
+        case 1:
+            return std::unexpected(
+                std::string("No valid month directories in img:") + dayPath);
+        case 2:
+            return std::unexpected(
+                std::string("No valid day directories in img:") + dayPath);
+        default:
+            break;
+    }
 
     // 4. Find File (Regular File)
-    const fs::path file = findMaxFileInDir(day);
-    if (file.empty())
-        return std::unexpected("No files found in " + day.string());
+    char name[ALBUM_NAME_MAX + 1];
+    if (!findNewestFile(fs, dayPath, name)) {
+        return std::unexpected(std::string("No files found in img:") +
+                               dayPath);
+    }
+
+    AlbumItem item;
+    makeItem(item, date, name);
+    char path[ALBUM_PATH_MAX];
+    item.path(path);
 
 #ifdef ENABLE_TIME_FUNCTIONS
     const auto endTime = std::chrono::high_resolution_clock::now();
     const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
         endTime - startTime);
-    Logger::get().debug() << "[getLastAlbumItem] Success " << " ("
-                          << duration.count() << "ms)" << endl;
+    LOG_DEBUG() << "[getLastAlbumItem] Success " << " (" << duration.count()
+                << "ms)" << endl;
     Logger::get().close();
 #endif
 
-    return file.string();
+    return std::string(path);
 }
 
-std::expected<std::vector<std::string>, std::string> getNewAlbumItems(
-    std::string_view lastItem) {
+namespace {
+
+// Filesystem backend: walk the album directories newer than lastItem
+std::expected<size_t, std::string> getNewAlbumItemsFs(std::string_view lastItem,
+                                                      AlbumItem* items,
+                                                      size_t capacity) {
 #ifdef ENABLE_TIME_FUNCTIONS
     const auto startTime = std::chrono::high_resolution_clock::now();
 #endif
 
-    std::vector<std::string> newItems;
+    // Nothing changed on the newest branch since the last walk
+    if (!lastItem.empty() && indexIsCurrent(lastItem)) {
+        return 0;
+    }
+
+    FsFileSystem* fs = fsdevGetDeviceFileSystem(ALBUM_DEVICE);
+    if (!fs) return std::unexpected("Image filesystem is not mounted");
 
     // If lastItem is empty, just get the latest item
     if (lastItem.empty()) {
-        auto result = getLastAlbumItem();
-        if (result.has_value()) {
-            newItems.push_back(std::move(result.value()));
+        u16 date[3];
+        char dayPath[DATE_PATH_SIZE];
+        char name[ALBUM_NAME_MAX + 1];
+        if (capacity == 0 || findNewestDay(fs, date, dayPath) < 3 ||
+            !findNewestFile(fs, dayPath, name)) {
+            return 0;
         }
-        return newItems;
-    }
-
-    // Parse lastItem path to extract year/month/day components
-    // Format: img:/YYYY/MM/DD/filename
-    // We need to find files newer than lastItem
-
-    // Extract components from lastItem path
-    // Expected format: img:/2024/01/15/filename.jpg
-    std::string lastItemStr(lastItem);
-
-    // Find year/month/day from the path
-    size_t pos = 0;
-    if (lastItemStr.starts_with("img:/")) {
-        pos = 5;  // Skip "img:/"
+        makeItem(items[0], date, name);
+        return 1;
     }
 
-    // Extract year (4 digits)
-    if (pos + 4 > lastItemStr.length())
+    // Year/month/day of lastItem bound the walk
+    u16 minDate[3];
+    if (!parseItemDate(lastItem, minDate)) {
         return std::unexpected("Invalid path format");
-    std::string_view minYear = std::string_view(lastItemStr).substr(pos, 4);
-    pos += 5;  // Skip "YYYY/"
-
-    // Extract month (2 digits)
-    if (pos + 2 > lastItemStr.length())
-        return std::unexpected("Invalid path format");
-    std::string_view minMonth = std::string_view(lastItemStr).substr(pos, 2);
-    pos += 3;  // Skip "MM/"
+    }
 
-    // Extract day (2 digits)
-    if (pos + 2 > lastItemStr.length())
-        return std::unexpected("Invalid path format");
-    std::string_view minDay = std::string_view(lastItemStr).substr(pos, 2);
-
-    // Collect all files newer than lastItem
-    std::vector<fs::path> years;
-    findDirsGreaterOrEqual<4>(ALBUM_PATH, minYear, years);
-
-    for (const auto& yearDir : years) {
-        auto yearName = yearDir.filename().string();
-        if (yearName == minYear) {
-            // This is the minimum year
-            collectFromYearDir(yearDir, lastItem, minMonth, minDay, true,
-                               newItems);
-        } else {
-            // This is a newer year, collect all files
-            collectFromYearDir(yearDir, lastItem, "", "", false, newItems);
+    // Snapshot the newest branch before walking
+    rebuildIndex(fs, lastItem);
+
+    // Collect the oldest files newer than lastItem, in directory order
+    OldestItems collector(items, capacity);
+    u16 date[3];
+    char path[DATE_PATH_SIZE];
+    DateDirs years;
+    listDateDirs(fs, "/", 4, minDate[0], years);
+    for (size_t y = 0; y < years.count; ++y) {
+        date[0] = years.values[y];
+        const bool isMinYear = date[0] == minDate[0];
+
+        DateDirs months;
+        formatDatePath(path, date, 1);
+        listDateDirs(fs, path, 2, isMinYear ? minDate[1] : 0, months);
+        for (size_t m = 0; m < months.count; ++m) {
+            date[1] = months.values[m];
+            const bool isMinMonth = isMinYear && date[1] == minDate[1];
+
+            DateDirs days;
+            formatDatePath(path, date, 2);
+            listDateDirs(fs, path, 2, isMinMonth ? minDate[2] : 0, days);
+            for (size_t d = 0; d < days.count; ++d) {
+                date[2] = days.values[d];
+                collectDay(fs, date, lastItem, collector);
+            }
         }
     }
 
     // Sort results to ensure chronological order
-    std::ranges::sort(newItems);
+    const size_t count = collector.finish();
+
+    if (collector.truncated()) {
+        // More remain past the last returned item; walk again next poll
+        g_index.valid = false;
+    } else if (count > 0 && g_index.valid) {
+        items[count - 1].path(g_index.newest);
+    }
 
 #ifdef ENABLE_TIME_FUNCTIONS
     const auto endTime = std::chrono::high_resolution_clock::now();
     const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
         endTime - startTime);
-    Logger::get().debug() << "[getNewAlbumItems] Found " << newItems.size()
-                          << " new items (" << duration.count() << "ms)"
-                          << endl;
+    LOG_DEBUG() << "[getNewAlbumItems] Found " << count << " new items ("
+                << duration.count() << "ms)" << endl;
     Logger::get().close();
 #endif
 
-    return newItems;
+    return count;
+}
+
+// Sortable capture key of an album entry, identical to the first 16
+// characters of its file name
+void formatCapsKey(const CapsAlbumFileDateTime& dt,
+                   char (&key)[CAPS_KEY_SIZE]) noexcept {
+    std::snprintf(key, sizeof(key), "%04u%02u%02u%02u%02u%02u%02u",
+                  static_cast<unsigned>(dt.year), dt.month, dt.day, dt.hour,
+                  dt.minute, dt.second, dt.id);
+}
+
+// Capture key of an album path ("img:/YYYY/MM/DD/<key>-<tid>.<ext>")
+std::string_view pathCapsKey(std::string_view path) noexcept {
+    const size_t slash = path.rfind('/');
+    const std::string_view name =
+        slash == std::string_view::npos ? path : path.substr(slash + 1);
+    return name.substr(0, std::min(name.size(), CAPS_KEY_LENGTH));
+}
+
+// Seconds since 0000-03-01 of a capture time, to split listing ranges
+// (days from the civil date as in Howard Hinnant's date algorithms)
+u64 capsSeconds(const CapsAlbumDateTime& dt) noexcept {
+    const unsigned year = dt.year - (dt.month <= 2 ? 1u : 0u);
+    const unsigned era = year / 400;
+    const unsigned yearOfEra = year - era * 400;
+    const unsigned dayOfYear =
+        (153 * (dt.month > 2 ? dt.month - 3u : dt.month + 9u) + 2) / 5 +
+        dt.day - 1;
+    const unsigned dayOfEra =
+        yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    const u64 days = static_cast<u64>(era) * 146097 + dayOfEra;
+    return ((days * 24 + dt.hour) * 60 + dt.minute) * 60 + dt.second;
+}
+
+CapsAlbumDateTime capsDateTime(u64 seconds) noexcept {
+    const u64 days = seconds / 86400;
+    const unsigned era = static_cast<unsigned>(days / 146097);
+    const unsigned dayOfEra = static_cast<unsigned>(days % 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 +
+                                dayOfEra / 36524 - dayOfEra / 146096) /
+                               365;
+    const unsigned dayOfYear =
+        dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;  // From March
+    const unsigned month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+
+    CapsAlbumDateTime dt{};
+    dt.year = static_cast<u16>(era * 400 + yearOfEra + (month <= 2 ? 1 : 0));
+    dt.month = static_cast<u8>(month);
+    dt.day = static_cast<u8>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    dt.hour = static_cast<u8>(seconds / 3600 % 24);
+    dt.minute = static_cast<u8>(seconds / 60 % 60);
+    dt.second = static_cast<u8>(seconds % 60);
+    return dt;
+}
+
+// Capture time (to the second) of a capture key
+bool parseCapsKey(std::string_view key, CapsAlbumDateTime& out) noexcept {
+    if (key.size() < 14 || !isDigitsOnly(key.substr(0, 14))) return false;
+
+    const auto field = [key](size_t offset, size_t length) {
+        unsigned value = 0;
+        std::from_chars(key.data() + offset, key.data() + offset + length,
+                        value);
+        return value;
+    };
+    out = {};
+    out.year = static_cast<u16>(field(0, 4));
+    out.month = static_cast<u8>(field(4, 2));
+    out.day = static_cast<u8>(field(6, 2));
+    out.hour = static_cast<u8>(field(8, 2));
+    out.minute = static_cast<u8>(field(10, 2));
+    out.second = static_cast<u8>(field(12, 2));
+    return out.month >= 1 && out.month <= 12 && out.day >= 1;
+}
+
+// List the regular screenshots and movies captured from `start` to `end`
+// into g_capsEntries, and collect those newer than lastKey into
+// g_capsFresh. Returns the number of entries listed (CAPS_LIST_CAPACITY if
+// the range may hold more), or std::nullopt if the listing failed.
+std::optional<size_t> listCapsRange(const CapsAlbumDateTime& start,
+                                    const CapsAlbumDateTime& end,
+                                    std::string_view lastKey,
+                                    size_t& freshCount) noexcept {
+    s64 listed = 0;
+    if (R_FAILED(capsaGetAlbumFileList3(g_storage, &listed, g_capsEntries,
+                                        CAPS_LIST_CAPACITY, &start, &end))) {
+        return std::nullopt;
+    }
+
+    freshCount = 0;
+    for (s64 i = 0; i < listed; ++i) {
+        const CapsAlbumEntry& entry = g_capsEntries[i];
+        const u8 content = entry.file_id.content;
+        if (content != CapsAlbumFileContents_ScreenShot &&
+            content != CapsAlbumFileContents_Movie) {
+            continue;
+        }
+
+        char key[CAPS_KEY_SIZE];
+        formatCapsKey(entry.file_id.datetime, key);
+        if (std::string_view(key) > lastKey) {
+            g_capsFresh[freshCount++] = static_cast<u16>(i);
+        }
+    }
+    return static_cast<size_t>(listed);
+}
+
+CapsTitle* findCapsTitle(u64 applicationId) noexcept {
+    for (CapsTitle& title : g_capsTitles) {
+        if (title.valid && title.applicationId == applicationId) return &title;
+    }
+    return nullptr;
+}
+
+// Remember the title part of a capture's file name
+void learnCapsTitle(u64 applicationId, std::string_view name) noexcept {
+    if (name.size() < CAPS_KEY_LENGTH + 1 + CAPS_TITLE_LENGTH ||
+        name[CAPS_KEY_LENGTH] != '-' || findCapsTitle(applicationId)) {
+        return;
+    }
+    CapsTitle& title = g_capsTitles[g_capsTitleNext];
+    g_capsTitleNext = (g_capsTitleNext + 1) % CAPS_TITLE_CACHE_SIZE;
+    title.applicationId = applicationId;
+    std::memcpy(title.name, name.data() + CAPS_KEY_LENGTH + 1,
+                CAPS_TITLE_LENGTH);
+    title.valid = true;
+}
+
+// Resolve an album entry to its file. The file name is built from the entry
+// once a capture of the same title has been seen, and checked with a single
+// IPC round-trip; otherwise the day directory is listed to learn it.
+bool resolveCapsEntry(FsFileSystem* fs, const CapsAlbumEntry& entry,
+                      AlbumItem& out) noexcept {
+    const CapsAlbumFileDateTime& dt = entry.file_id.datetime;
+    char key[CAPS_KEY_SIZE];
+    formatCapsKey(dt, key);
+
+    const u16 date[3] = {dt.year, dt.month, dt.day};
+    char dayPath[DATE_PATH_SIZE];
+    formatDatePath(dayPath, date, 3);
+
+    const std::string_view extension =
+        entry.file_id.content == CapsAlbumFileContents_Movie ? ".mp4" : ".jpg";
+
+    if (const CapsTitle* title = findCapsTitle(entry.file_id.application_id)) {
+        char path[DATE_PATH_SIZE + ALBUM_NAME_MAX + 1];
+        const int length = std::snprintf(
+            path, sizeof(path), "%s/%s-%.*s%.*s", dayPath, key,
+            static_cast<int>(CAPS_TITLE_LENGTH), title->name,
+            static_cast<int>(extension.size()), extension.data());
+        const std::string_view name =
+            std::string_view(path).substr(std::strlen(dayPath) + 1);
+
+        FsDirEntryType type;
+        if (length > 0 && static_cast<size_t>(length) < sizeof(path) &&
+            name.size() <= ALBUM_NAME_MAX &&
+            R_SUCCEEDED(fsFsGetEntryType(fs, path, &type)) &&
+            type == FsDirEntryType_File) {
+            makeItem(out, date, name);
+            return true;
+        }
+    }
+
+    bool found = false;
+    forEachEntry(fs, dayPath, FsDirOpenMode_ReadFiles,
+                 [&](std::string_view name, bool isDirectory) {
+                     if (found || isDirectory || name.size() > ALBUM_NAME_MAX ||
+                         !name.starts_with(key) || !name.ends_with(extension)) {
+                         return;
+                     }
+                     makeItem(out, date, name);
+                     learnCapsTitle(entry.file_id.application_id, name);
+                     found = true;
+                 });
+    return found;
+}
+
+// capsa backend: ask the album service for entries newer than lastItem.
+// Only the captures from lastItem's second on are listed, so an unchanged
+// album costs a single listing of about one entry; going by capture time
+// also sees a new capture that replaced a deleted one. If the captures do
+// not fit the listing, the range is halved until they do, and the rest is
+// left for the next poll. Returns std::nullopt if the listing cannot be
+// used (the caller falls back to the filesystem walk).
+std::optional<size_t> getNewAlbumItemsCaps(std::string_view lastItem,
+                                           AlbumItem* items,
+                                           size_t capacity) {
+    FsFileSystem* fs = fsdevGetDeviceFileSystem(ALBUM_DEVICE);
+    if (!fs) return std::nullopt;
+
+    const std::string_view lastKey = pathCapsKey(lastItem);
+    CapsAlbumDateTime start;
+    if (!parseCapsKey(lastKey, start)) return std::nullopt;
+
+    size_t freshCount = 0;
+    auto listed = listCapsRange(start, CAPS_RANGE_END, lastKey, freshCount);
+    if (!listed) return std::nullopt;
+
+    // Too many to list at once: find an end of the range whose listing fits
+    // and holds something newer than lastItem
+    if (*listed == CAPS_LIST_CAPACITY) {
+        u64 fits = capsSeconds(start);
+        u64 overflows = capsSeconds(CAPS_RANGE_END);
+        bool usable = false;
+        while (!usable && overflows - fits > 1) {
+            const u64 middle = fits + (overflows - fits) / 2;
+            listed = listCapsRange(start, capsDateTime(middle), lastKey,
+                                   freshCount);
+            if (!listed) return std::nullopt;
+
+            if (*listed == CAPS_LIST_CAPACITY) {
+                overflows = middle;
+            } else {
+                fits = middle;
+                usable = freshCount > 0;
+            }
+        }
+        if (!usable) {
+            LOG_WARN() << "[capsa] Cannot narrow the listing after "
+                       << lastItem << ", using fs walk" << endl;
+            return std::nullopt;
+        }
+    }
+
+    // Order by exact capture time (the id breaks ties within one second)
+    std::sort(g_capsFresh, g_capsFresh + freshCount, [](u16 a, u16 b) {
+        char keyA[CAPS_KEY_SIZE];
+        char keyB[CAPS_KEY_SIZE];
+        formatCapsKey(g_capsEntries[a].file_id.datetime, keyA);
+        formatCapsKey(g_capsEntries[b].file_id.datetime, keyB);
+        return std::string_view(keyA) < std::string_view(keyB);
+    });
+
+    size_t found = 0;
+    for (size_t i = 0; i < freshCount && found < capacity; ++i) {
+        if (!resolveCapsEntry(fs, g_capsEntries[g_capsFresh[i]],
+                              items[found])) {
+            // Not visible on the filesystem yet; pick it up next poll
+            return found;
+        }
+        ++found;
+    }
+    return found;
+}
+
+}  // namespace
+
+void albumInit(CapsAlbumStorage storage) {
+    g_storage = storage;
+}
+
+std::expected<size_t, std::string> getNewAlbumItems(std::string_view lastItem,
+                                                    AlbumItem* items,
+                                                    size_t capacity) {
+    if (!lastItem.empty() &&
+        Config::get().getAlbumBackend() == AlbumBackend::Capsa) {
+        if (auto count = getNewAlbumItemsCaps(lastItem, items, capacity)) {
+            return *count;
+        }
+    }
+    return getNewAlbumItemsFs(lastItem, items, capacity);
+}
+
+bool albumSaveMovieThumbnail(std::string_view moviePath,
+                             const char* jpegPath) {
+    // Only allocated while a recording is being previewed
+    const std::unique_ptr<u8[]> buffer(new (std::nothrow)
+                                           u8[THUMBNAIL_BUFFER_SIZE]);
+    if (!buffer) return false;
+
+    // The overlay is the one place that names a recording's album id
+    // without listing the whole album, so older recordings get no preview
+    CapsOverlayThumbnailData overlay{};
+    Result rc = capsaGetLastOverlayMovieThumbnail(&overlay, buffer.get(),
+                                                  OVERLAY_IMAGE_SIZE);
+    if (R_FAILED(rc)) {
+        LOG_DEBUG() << "[capsa] No last recording: " << rc << endl;
+        return false;
+    }
+
+    char key[CAPS_KEY_SIZE];
+    formatCapsKey(overlay.file_id.datetime, key);
+    if (pathCapsKey(moviePath) != key) {
+        LOG_DEBUG() << "[capsa] " << moviePath
+                    << " is not the last recording (" << key << ")" << endl;
+        return false;
+    }
+
+    u64 size = 0;
+    rc = capsaLoadAlbumFileThumbnail(&overlay.file_id, &size, buffer.get(),
+                                     THUMBNAIL_BUFFER_SIZE);
+    if (R_FAILED(rc) || size == 0) {
+        LOG_WARN() << "[capsa] capsaLoadAlbumFileThumbnail() failed: " << rc
+                   << endl;
+        return false;
+    }
+
+    FILE* f = std::fopen(jpegPath, "wb");
+    if (!f) {
+        LOG_WARN() << "[capsa] Failed to create " << jpegPath << endl;
+        return false;
+    }
+    const bool written = std::fwrite(buffer.get(), 1, size, f) == size;
+    if (std::fclose(f) != 0 || !written) {
+        std::remove(jpegPath);
+        return false;
+    }
+    return true;
 }
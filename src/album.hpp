@@ -1,10 +1,46 @@
 #pragma once
 
+#include <switch.h>
+
+#include <cstddef>
 #include <expected>
 #include <string>
 #include <string_view>
-#include <vector>
+
+// Longest album path: "img:/YYYY/MM/DD/" plus a file name of up to
+// ALBUM_NAME_MAX characters and the terminator
+constexpr size_t ALBUM_NAME_MAX = 55;
+constexpr size_t ALBUM_PATH_MAX = 16 + ALBUM_NAME_MAX + 1;
+
+// Most new items returned by one poll; anything beyond is picked up by the
+// next one
+constexpr size_t MAX_NEW_ALBUM_ITEMS = 32;
+
+// One album capture in a fixed 64-byte record, so discovery never touches
+// the heap. Capture file names are "YYYYMMDDHHMMSSII-<title id>.<ext>"
+// (53 characters); the day directory is kept separately.
+struct AlbumItem {
+    char day[8];                    // "YYYYMMDD", not terminated
+    char name[ALBUM_NAME_MAX + 1];  // File name inside the day directory
+
+    // Write the full path ("img:/YYYY/MM/DD/<name>")
+    void path(char (&out)[ALBUM_PATH_MAX]) const noexcept;
+};
+static_assert(sizeof(AlbumItem) == 64);
 
 [[nodiscard]] std::expected<std::string, std::string> getLastAlbumItem();
-[[nodiscard]] std::expected<std::vector<std::string>, std::string>
-getNewAlbumItems(std::string_view lastItem);
+
+// Fill `items` with up to `capacity` captures newer than lastItem, oldest
+// first. Returns the number written. If lastItem is empty, only the newest
+// capture is returned.
+[[nodiscard]] std::expected<size_t, std::string> getNewAlbumItems(
+    std::string_view lastItem, AlbumItem* items, size_t capacity);
+
+// Set the album storage queried by the capsa discovery backend
+void albumInit(CapsAlbumStorage storage);
+
+// Write the JPEG thumbnail the album service keeps for a recording to
+// `jpegPath`. Only works for the most recent recording; returns false for
+// any other or if the thumbnail cannot be read.
+[[nodiscard]] bool albumSaveMovieThumbnail(std::string_view moviePath,
+                                           const char* jpegPath);
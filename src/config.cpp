@@ -1,8 +1,13 @@
 #include "config.hpp"
 
-#include <minIni.h>
+#include <switch.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "ini.hpp"
 #include "logger.hpp"
 #include "project.h"
 
@@ -10,106 +15,197 @@
 static constexpr const char* CONFIG_PATH =
     "sdmc:/config/" APP_TITLE "/config.ini";
 
-// Helper: read a string value with an upper bound of maxlen characters
-static std::string ini_get_string(const char* section, const char* key,
-                                  std::string_view default_value) {
-    char stackBuffer[256];
-    int len = ini_gets(section, key, default_value.data(), stackBuffer,
-                       sizeof(stackBuffer), CONFIG_PATH);
-    if (len > 0) {
-        return std::string(stackBuffer, len);
-    } else {
-        return std::string(default_value);
+namespace {
+// Identifies the file contents a snapshot was parsed from
+struct FileStamp {
+    time_t mtime{0};
+    off_t size{-1};
+
+    [[nodiscard]] bool operator==(const FileStamp&) const = default;
+};
+
+FileStamp configFileStamp() {
+    struct stat st;
+    if (stat(CONFIG_PATH, &st) != 0) return {};
+    return {st.st_mtime, st.st_size};
+}
+
+Mutex g_configMutex;
+std::atomic<const Config*> g_activeConfig{nullptr};
+std::unique_ptr<Config> g_currentConfig;
+std::unique_ptr<Config> g_previousConfig;
+std::unique_ptr<Config> g_pendingConfig;
+std::atomic<uint32_t> g_configGeneration{0};
+FileStamp g_parsedStamp;  // Detection loop only
+
+// Read transcode_quality and transcode_width of a channel section
+TranscodeSettings readTranscode(const IniFile& ini, std::string_view section,
+                                int defaultQuality) {
+    const long quality =
+        ini.getLong(section, "transcode_quality", defaultQuality);
+    const long width = ini.getLong(section, "transcode_width",
+                                   ConfigDefaults::TRANSCODE_WIDTH);
+    return {
+        static_cast<int>(std::clamp(
+            quality, 0L, long{ConfigDefaults::TRANSCODE_QUALITY_MAXIMUM})),
+        static_cast<int>(
+            std::clamp(width, long{ConfigDefaults::TRANSCODE_WIDTH_MINIMUM},
+                       long{ConfigDefaults::TRANSCODE_WIDTH_MAXIMUM}))};
+}
+
+// Read video_part_size of a channel section
+int readVideoPartSize(const IniFile& ini, std::string_view section) {
+    const long size = ini.getLong(section, "video_part_size",
+                                  ConfigDefaults::VIDEO_PART_SIZE_MB);
+    return static_cast<int>(std::clamp(
+        size, 0L, long{ConfigDefaults::VIDEO_PART_SIZE_MB_MAXIMUM}));
+}
+}  // namespace
+
+const Config& Config::get() noexcept {
+    if (const Config* active =
+            g_activeConfig.load(std::memory_order_acquire)) {
+        return *active;
     }
+    static const Config defaults;
+    return defaults;
 }
 
-// Helper: read a boolean value
-static bool ini_get_bool(const char* section, const char* key,
-                         bool default_value) {
-    return ini_getbool(section, key, default_value ? 1 : 0, CONFIG_PATH) != 0;
+bool Config::load() {
+    mutexInit(&g_configMutex);
+
+    g_parsedStamp = configFileStamp();
+    std::unique_ptr<Config> config(new Config());
+    const bool valid = config->refresh();
+
+    g_currentConfig = std::move(config);
+    g_activeConfig.store(g_currentConfig.get(), std::memory_order_release);
+    g_configGeneration.fetch_add(1, std::memory_order_release);
+    return valid;
+}
+
+bool Config::reloadIfChanged() {
+    const FileStamp stamp = configFileStamp();
+    if (stamp == g_parsedStamp) return false;
+    g_parsedStamp = stamp;
+
+    std::unique_ptr<Config> config(new Config());
+    if (!config->refresh()) {
+        LOG_WARN() << "Config reload rejected: no valid upload channel, "
+                      "keeping current settings"
+                   << endl;
+        return false;
+    }
+
+    mutexLock(&g_configMutex);
+    g_pendingConfig = std::move(config);
+    mutexUnlock(&g_configMutex);
+
+    LOG_INFO() << "Config change detected, applying after current upload"
+               << endl;
+    return true;
 }
 
-// Helper: read an integer value
-static long ini_get_long(const char* section, const char* key,
-                         long default_value) {
-    return ini_getl(section, key, default_value, CONFIG_PATH);
+bool Config::commitPending() {
+    mutexLock(&g_configMutex);
+    if (!g_pendingConfig) {
+        mutexUnlock(&g_configMutex);
+        return false;
+    }
+
+    g_previousConfig = std::move(g_currentConfig);
+    g_currentConfig = std::move(g_pendingConfig);
+    g_activeConfig.store(g_currentConfig.get(), std::memory_order_release);
+    g_configGeneration.fetch_add(1, std::memory_order_release);
+    mutexUnlock(&g_configMutex);
+
+    LOG_INFO() << "Configuration reloaded" << endl;
+    return true;
 }
 
-// Helper: check if config file exists
-static bool configFileExists() {
-    struct stat buffer;
-    return stat(CONFIG_PATH, &buffer) == 0;
+uint32_t Config::generation() noexcept {
+    return g_configGeneration.load(std::memory_order_acquire);
 }
 
 bool Config::refresh() {
-    // Check if config file exists
-    if (!configFileExists()) {
-        Logger::get().error()
-            << "Config file not found at: " << CONFIG_PATH << endl;
+    // Read and parse the whole file once; every value below is looked up in
+    // memory
+    IniFile ini;
+    if (!ini.load(CONFIG_PATH)) {
+        LOG_ERROR() << "Config file not found at: " << CONFIG_PATH << endl;
         return false;
     }
 
     // Read upload destination toggles
     m_telegramEnabled =
-        ini_get_bool("general", "telegram", ConfigDefaults::TELEGRAM_ENABLED);
+        ini.getBool("general", "telegram", ConfigDefaults::TELEGRAM_ENABLED);
     m_ntfyEnabled =
-        ini_get_bool("general", "ntfy", ConfigDefaults::NTFY_ENABLED);
+        ini.getBool("general", "ntfy", ConfigDefaults::NTFY_ENABLED);
     m_discordEnabled =
-        ini_get_bool("general", "discord", ConfigDefaults::DISCORD_ENABLED);
+        ini.getBool("general", "discord", ConfigDefaults::DISCORD_ENABLED);
 
     // Read Telegram configuration from [telegram] section
-    m_telegramBotToken = ini_get_string("telegram", "bot_token",
-                                        ConfigDefaults::TELEGRAM_BOT_TOKEN);
+    m_telegramBotToken = ini.getString("telegram", "bot_token",
+                                       ConfigDefaults::TELEGRAM_BOT_TOKEN);
     m_telegramChatId =
-        ini_get_string("telegram", "chat_id", ConfigDefaults::TELEGRAM_CHAT_ID);
+        ini.getString("telegram", "chat_id", ConfigDefaults::TELEGRAM_CHAT_ID);
     m_telegramApiUrl =
-        ini_get_string("telegram", "api_url", ConfigDefaults::TELEGRAM_API_URL);
+        ini.getString("telegram", "api_url", ConfigDefaults::TELEGRAM_API_URL);
     m_telegramUploadScreenshots =
-        ini_get_bool("telegram", "upload_screenshots",
-                     ConfigDefaults::TELEGRAM_UPLOAD_SCREENSHOTS);
-    m_telegramUploadMovies = ini_get_bool(
+        ini.getBool("telegram", "upload_screenshots",
+                    ConfigDefaults::TELEGRAM_UPLOAD_SCREENSHOTS);
+    m_telegramUploadMovies = ini.getBool(
         "telegram", "upload_movies", ConfigDefaults::TELEGRAM_UPLOAD_MOVIES);
 
     // Read Telegram upload mode: compressed, original, or both
     // Stored directly as string to avoid unnecessary conversions
-    m_telegramUploadMode = ini_get_string("telegram", "upload_mode",
-                                          ConfigDefaults::TELEGRAM_UPLOAD_MODE);
+    m_telegramUploadMode = ini.getString("telegram", "upload_mode",
+                                         ConfigDefaults::TELEGRAM_UPLOAD_MODE);
+    m_telegramTranscode = readTranscode(
+        ini, "telegram", ConfigDefaults::TELEGRAM_TRANSCODE_QUALITY);
+    m_telegramVideoPartSizeMB = readVideoPartSize(ini, "telegram");
 
     // Read Ntfy configuration from [ntfy] section
-    m_ntfyUrl = ini_get_string("ntfy", "url", ConfigDefaults::NTFY_URL);
-    m_ntfyTopic = ini_get_string("ntfy", "topic", ConfigDefaults::NTFY_TOPIC);
-    m_ntfyToken = ini_get_string("ntfy", "token", ConfigDefaults::NTFY_TOKEN);
+    m_ntfyUrl = ini.getString("ntfy", "url", ConfigDefaults::NTFY_URL);
+    m_ntfyTopic = ini.getString("ntfy", "topic", ConfigDefaults::NTFY_TOPIC);
+    m_ntfyToken = ini.getString("ntfy", "token", ConfigDefaults::NTFY_TOKEN);
     m_ntfyPriority =
-        ini_get_string("ntfy", "priority", ConfigDefaults::NTFY_PRIORITY);
-    m_ntfyUploadScreenshots = ini_get_bool(
+        ini.getString("ntfy", "priority", ConfigDefaults::NTFY_PRIORITY);
+    m_ntfyUploadScreenshots = ini.getBool(
         "ntfy", "upload_screenshots", ConfigDefaults::NTFY_UPLOAD_SCREENSHOTS);
-    m_ntfyUploadMovies = ini_get_bool("ntfy", "upload_movies",
-                                      ConfigDefaults::NTFY_UPLOAD_MOVIES);
+    m_ntfyUploadMovies = ini.getBool("ntfy", "upload_movies",
+                                     ConfigDefaults::NTFY_UPLOAD_MOVIES);
+    m_ntfyTranscode =
+        readTranscode(ini, "ntfy", ConfigDefaults::NTFY_TRANSCODE_QUALITY);
+    m_ntfyVideoPartSizeMB = readVideoPartSize(ini, "ntfy");
 
     // Read Discord configuration from [discord] section
-    m_discordBotToken = ini_get_string("discord", "bot_token",
-                                       ConfigDefaults::DISCORD_BOT_TOKEN);
-    m_discordChannelId = ini_get_string("discord", "channel_id",
-                                        ConfigDefaults::DISCORD_CHANNEL_ID);
+    m_discordBotToken = ini.getString("discord", "bot_token",
+                                      ConfigDefaults::DISCORD_BOT_TOKEN);
+    m_discordChannelId = ini.getString("discord", "channel_id",
+                                       ConfigDefaults::DISCORD_CHANNEL_ID);
     m_discordApiUrl =
-        ini_get_string("discord", "api_url", ConfigDefaults::DISCORD_API_URL);
+        ini.getString("discord", "api_url", ConfigDefaults::DISCORD_API_URL);
     m_discordUploadScreenshots =
-        ini_get_bool("discord", "upload_screenshots",
-                     ConfigDefaults::DISCORD_UPLOAD_SCREENSHOTS);
-    m_discordUploadMovies = ini_get_bool("discord", "upload_movies",
-                                         ConfigDefaults::DISCORD_UPLOAD_MOVIES);
+        ini.getBool("discord", "upload_screenshots",
+                    ConfigDefaults::DISCORD_UPLOAD_SCREENSHOTS);
+    m_discordUploadMovies = ini.getBool("discord", "upload_movies",
+                                        ConfigDefaults::DISCORD_UPLOAD_MOVIES);
+    m_discordTranscode = readTranscode(
+        ini, "discord", ConfigDefaults::DISCORD_TRANSCODE_QUALITY);
+    m_discordVideoPartSizeMB = readVideoPartSize(ini, "discord");
 
     // Read general settings
     m_keepLogs =
-        ini_get_bool("general", "keep_logs", ConfigDefaults::KEEP_LOGS);
+        ini.getBool("general", "keep_logs", ConfigDefaults::KEEP_LOGS);
     m_logLevel =
-        ini_get_string("general", "log_level", ConfigDefaults::LOG_LEVEL);
+        ini.getString("general", "log_level", ConfigDefaults::LOG_LEVEL);
 
     // Validate log level
     // Valid values: debug, info, warn, error
     if (m_logLevel != "debug" && m_logLevel != "info" && m_logLevel != "warn" &&
         m_logLevel != "error") {
-        Logger::get().warn()
+        LOG_WARN()
             << "Invalid log_level: '" << m_logLevel
             << "' (valid levels: debug, info, warn, error). Resetting to "
                "default (info)."
@@ -117,19 +213,111 @@ bool Config::refresh() {
         m_logLevel = ConfigDefaults::LOG_LEVEL;
     }
 
+    // Read album discovery backend
+    m_albumBackend = ini.getString("general", "album_backend",
+                                   ConfigDefaults::ALBUM_BACKEND);
+    if (!ConfigDefaults::isAlbumBackendValid(m_albumBackend)) {
+        LOG_WARN()
+            << "Invalid album_backend: '" << m_albumBackend
+            << "' (valid backends: fs, capsa). Resetting to default (fs)."
+            << endl;
+        m_albumBackend = ConfigDefaults::ALBUM_BACKEND;
+    }
+
+    m_detectionMode = ini.getString("general", "detection_mode",
+                                    ConfigDefaults::DETECTION_MODE);
+    if (!ConfigDefaults::isDetectionModeValid(m_detectionMode)) {
+        LOG_WARN()
+            << "Invalid detection_mode: '" << m_detectionMode
+            << "' (valid modes: poll, event). Resetting to default (poll)."
+            << endl;
+        m_detectionMode = ConfigDefaults::DETECTION_MODE;
+    }
+
     // Read check interval (seconds), with minimum enforcement using std::max
     m_checkIntervalSeconds = std::max(
-        static_cast<int>(ini_get_long("general", "check_interval",
-                                      ConfigDefaults::CHECK_INTERVAL_SECONDS)),
+        static_cast<int>(ini.getLong("general", "check_interval",
+                                     ConfigDefaults::CHECK_INTERVAL_SECONDS)),
         ConfigDefaults::CHECK_INTERVAL_MINIMUM);
 
+    // Read idle check interval ceiling; equal to check_interval disables
+    // the backoff
+    m_checkIntervalMaxSeconds =
+        std::max(static_cast<int>(
+                     ini.getLong("general", "check_interval_max",
+                                 ConfigDefaults::CHECK_INTERVAL_MAX_SECONDS)),
+                 m_checkIntervalSeconds);
+
+    // Read burst batch size, clamped to what Telegram and Discord accept
+    m_batchSize = std::clamp(
+        static_cast<int>(ini.getLong("general", "batch_size",
+                                     ConfigDefaults::BATCH_SIZE)),
+        ConfigDefaults::BATCH_SIZE_MINIMUM, ConfigDefaults::BATCH_SIZE_MAXIMUM);
+
+    // Read upload pacing
+    m_uploadPacing = ini.getString("general", "upload_pacing",
+                                   ConfigDefaults::UPLOAD_PACING);
+    if (!ConfigDefaults::isUploadPacingValid(m_uploadPacing)) {
+        LOG_WARN() << "Invalid upload_pacing: '" << m_uploadPacing
+                   << "' (valid modes: off, in_game, always). Resetting to "
+                      "default (off)."
+                   << endl;
+        m_uploadPacing = ConfigDefaults::UPLOAD_PACING;
+    }
+    m_uploadRateLimitKBps = std::max(
+        static_cast<int>(ini.getLong("general", "upload_rate_limit",
+                                     ConfigDefaults::UPLOAD_RATE_LIMIT_KBPS)),
+        ConfigDefaults::UPLOAD_RATE_LIMIT_MINIMUM);
+    m_deferVideosInGame = ini.getBool("general", "defer_videos_in_game",
+                                      ConfigDefaults::DEFER_VIDEOS_IN_GAME);
+
+    m_writeStats =
+        ini.getBool("general", "write_stats", ConfigDefaults::WRITE_STATS);
+    m_skipDuplicates = ini.getBool("general", "skip_duplicates",
+                                   ConfigDefaults::SKIP_DUPLICATES);
+    m_videoPreview = ini.getBool("general", "video_preview",
+                                 ConfigDefaults::VIDEO_PREVIEW);
+
+    // Read lazy network settings
+    m_lazyNetwork =
+        ini.getBool("general", "lazy_network", ConfigDefaults::LAZY_NETWORK);
+    m_networkIdleTimeoutSeconds = std::max(
+        static_cast<int>(
+            ini.getLong("general", "network_idle_timeout",
+                        ConfigDefaults::NETWORK_IDLE_TIMEOUT_SECONDS)),
+        ConfigDefaults::NETWORK_IDLE_TIMEOUT_MINIMUM);
+
+    // Read transfer profiles
+    m_imageTransferProfile =
+        ini.getString("general", "image_transfer_profile",
+                      ConfigDefaults::IMAGE_TRANSFER_PROFILE);
+    if (!ConfigDefaults::isTransferProfileValid(m_imageTransferProfile)) {
+        LOG_WARN() << "Invalid image_transfer_profile: '"
+                   << m_imageTransferProfile
+                   << "' (valid profiles: small, medium, large). Resetting "
+                      "to default (small)."
+                   << endl;
+        m_imageTransferProfile = ConfigDefaults::IMAGE_TRANSFER_PROFILE;
+    }
+    m_videoTransferProfile =
+        ini.getString("general", "video_transfer_profile",
+                      ConfigDefaults::VIDEO_TRANSFER_PROFILE);
+    if (!ConfigDefaults::isTransferProfileValid(m_videoTransferProfile)) {
+        LOG_WARN() << "Invalid video_transfer_profile: '"
+                   << m_videoTransferProfile
+                   << "' (valid profiles: small, medium, large). Resetting "
+                      "to default (medium)."
+                   << endl;
+        m_videoTransferProfile = ConfigDefaults::VIDEO_TRANSFER_PROFILE;
+    }
+
     // ========================================================================
     // Validate configuration and disable invalid channels
     // ========================================================================
 
     // Validate Telegram upload mode
     if (!ConfigDefaults::isUploadModeValid(m_telegramUploadMode)) {
-        Logger::get().warn()
+        LOG_WARN()
             << "Invalid Telegram upload mode: '" << m_telegramUploadMode
             << "' (valid modes: compressed, original, both). Resetting to "
                "default."
@@ -140,7 +328,7 @@ bool Config::refresh() {
     // Validate Telegram configuration
     if (m_telegramEnabled && !ConfigDefaults::isTelegramValid(
                                  m_telegramBotToken, m_telegramChatId)) {
-        Logger::get().warn()
+        LOG_WARN()
             << "Telegram channel disabled: Invalid or missing configuration "
                "(bot_token and/or chat_id are not set or are set to "
                "'undefined')"
@@ -150,7 +338,7 @@ bool Config::refresh() {
 
     // Validate Ntfy configuration
     if (m_ntfyEnabled && !ConfigDefaults::isNtfyValid(m_ntfyTopic)) {
-        Logger::get().warn()
+        LOG_WARN()
             << "Ntfy channel disabled: Invalid or missing configuration (topic "
                "is not set)"
             << endl;
@@ -160,7 +348,7 @@ bool Config::refresh() {
     // Validate Discord configuration
     if (m_discordEnabled && !ConfigDefaults::isDiscordValid(
                                 m_discordBotToken, m_discordChannelId)) {
-        Logger::get().warn()
+        LOG_WARN()
             << "discord channel disabled: Invalid or missing configuration "
                "(bot_token and/or channel_id are not set or are set to "
                "'undefined')"
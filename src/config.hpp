@@ -1,29 +1,87 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 
 #include "config_defaults.hpp"
-
+#include "transcode.hpp"
+
+// Settings are held in immutable snapshots so config.ini can be reloaded
+// while the module runs. The detection loop parses a changed file into a
+// pending snapshot (reloadIfChanged) and the upload worker activates it
+// between queue items (commitPending), so an upload never sees its settings
+// change halfway through. The replaced snapshot is kept alive until the next
+// commit, which lets the detection loop finish the poll that was in flight.
 class Config {
    public:
-    static Config& get() noexcept {
-        static Config instance;
-        return instance;
-    }
+    // Active snapshot (defaults until load() has run)
+    [[nodiscard]] static const Config& get() noexcept;
 
-    [[nodiscard]] bool refresh();
+    // Parse config.ini and make it active; call once at startup before the
+    // worker thread exists. Returns false if no upload channel is usable.
+    [[nodiscard]] static bool load();
+
+    // Parse config.ini into a pending snapshot if its mtime or size changed
+    // since the last parse. Returns true if a new snapshot is pending.
+    static bool reloadIfChanged();
+
+    // Activate the pending snapshot, if any. Returns true if it was swapped
+    static bool commitPending();
+
+    // Incremented on every activation so readers can notice a swap
+    [[nodiscard]] static uint32_t generation() noexcept;
 
     // General settings
     [[nodiscard]] constexpr int getCheckIntervalSeconds() const noexcept {
         return m_checkIntervalSeconds;
     }
+    [[nodiscard]] constexpr int getCheckIntervalMaxSeconds() const noexcept {
+        return m_checkIntervalMaxSeconds;
+    }
     [[nodiscard]] constexpr bool keepLogs() const noexcept {
         return m_keepLogs;
     }
     [[nodiscard]] std::string_view getLogLevel() const noexcept {
         return m_logLevel;
     }
+    [[nodiscard]] std::string_view getAlbumBackend() const noexcept {
+        return m_albumBackend;
+    }
+    [[nodiscard]] std::string_view getDetectionMode() const noexcept {
+        return m_detectionMode;
+    }
+    [[nodiscard]] constexpr int getBatchSize() const noexcept {
+        return m_batchSize;
+    }
+    [[nodiscard]] std::string_view getUploadPacing() const noexcept {
+        return m_uploadPacing;
+    }
+    [[nodiscard]] constexpr int getUploadRateLimitKBps() const noexcept {
+        return m_uploadRateLimitKBps;
+    }
+    [[nodiscard]] constexpr bool deferVideosInGame() const noexcept {
+        return m_deferVideosInGame;
+    }
+    [[nodiscard]] constexpr bool writeStats() const noexcept {
+        return m_writeStats;
+    }
+    [[nodiscard]] constexpr bool videoPreview() const noexcept {
+        return m_videoPreview;
+    }
+    [[nodiscard]] constexpr bool skipDuplicates() const noexcept {
+        return m_skipDuplicates;
+    }
+    [[nodiscard]] constexpr bool lazyNetwork() const noexcept {
+        return m_lazyNetwork;
+    }
+    [[nodiscard]] constexpr int getNetworkIdleTimeoutSeconds() const noexcept {
+        return m_networkIdleTimeoutSeconds;
+    }
+    [[nodiscard]] std::string_view getTransferProfile(
+        bool isVideo) const noexcept {
+        return isVideo ? m_videoTransferProfile : m_imageTransferProfile;
+    }
 
     // Upload destination toggles
     [[nodiscard]] constexpr bool telegramEnabled() const noexcept {
@@ -49,6 +107,13 @@ class Config {
     [[nodiscard]] std::string_view getTelegramUploadMode() const noexcept {
         return m_telegramUploadMode;
     }
+    [[nodiscard]] constexpr TranscodeSettings getTelegramTranscode()
+        const noexcept {
+        return m_telegramTranscode;
+    }
+    [[nodiscard]] constexpr int getTelegramVideoPartSizeMB() const noexcept {
+        return m_telegramVideoPartSizeMB;
+    }
 
     // Ntfy configuration
     [[nodiscard]] std::string_view getNtfyUrl() const noexcept;
@@ -61,6 +126,13 @@ class Config {
     [[nodiscard]] constexpr bool ntfyUploadMovies() const noexcept {
         return m_ntfyUploadMovies;
     }
+    [[nodiscard]] constexpr TranscodeSettings getNtfyTranscode()
+        const noexcept {
+        return m_ntfyTranscode;
+    }
+    [[nodiscard]] constexpr int getNtfyVideoPartSizeMB() const noexcept {
+        return m_ntfyVideoPartSizeMB;
+    }
 
     // Discord configuration
     [[nodiscard]] std::string_view getDiscordBotToken() const noexcept;
@@ -72,18 +144,40 @@ class Config {
     [[nodiscard]] constexpr bool discordUploadMovies() const noexcept {
         return m_discordUploadMovies;
     }
-
-    bool error{false};
+    [[nodiscard]] constexpr TranscodeSettings getDiscordTranscode()
+        const noexcept {
+        return m_discordTranscode;
+    }
+    [[nodiscard]] constexpr int getDiscordVideoPartSizeMB() const noexcept {
+        return m_discordVideoPartSizeMB;
+    }
 
    private:
     Config() = default;
     Config(const Config&) = delete;
     Config& operator=(const Config&) = delete;
 
+    [[nodiscard]] bool refresh();
+
     // General settings
     int m_checkIntervalSeconds{ConfigDefaults::CHECK_INTERVAL_SECONDS};
+    int m_checkIntervalMaxSeconds{ConfigDefaults::CHECK_INTERVAL_MAX_SECONDS};
     bool m_keepLogs{ConfigDefaults::KEEP_LOGS};
     std::string m_logLevel{ConfigDefaults::LOG_LEVEL};
+    std::string m_albumBackend{ConfigDefaults::ALBUM_BACKEND};
+    std::string m_detectionMode{ConfigDefaults::DETECTION_MODE};
+    int m_batchSize{ConfigDefaults::BATCH_SIZE};
+    std::string m_uploadPacing{ConfigDefaults::UPLOAD_PACING};
+    int m_uploadRateLimitKBps{ConfigDefaults::UPLOAD_RATE_LIMIT_KBPS};
+    bool m_deferVideosInGame{ConfigDefaults::DEFER_VIDEOS_IN_GAME};
+    bool m_writeStats{ConfigDefaults::WRITE_STATS};
+    bool m_skipDuplicates{ConfigDefaults::SKIP_DUPLICATES};
+    bool m_videoPreview{ConfigDefaults::VIDEO_PREVIEW};
+    bool m_lazyNetwork{ConfigDefaults::LAZY_NETWORK};
+    int m_networkIdleTimeoutSeconds{
+        ConfigDefaults::NETWORK_IDLE_TIMEOUT_SECONDS};
+    std::string m_imageTransferProfile{ConfigDefaults::IMAGE_TRANSFER_PROFILE};
+    std::string m_videoTransferProfile{ConfigDefaults::VIDEO_TRANSFER_PROFILE};
 
     // Upload destination toggles
     bool m_telegramEnabled{ConfigDefaults::TELEGRAM_ENABLED};
@@ -98,6 +192,10 @@ class Config {
         ConfigDefaults::TELEGRAM_UPLOAD_SCREENSHOTS};
     bool m_telegramUploadMovies{ConfigDefaults::TELEGRAM_UPLOAD_MOVIES};
     std::string m_telegramUploadMode{ConfigDefaults::TELEGRAM_UPLOAD_MODE};
+    TranscodeSettings m_telegramTranscode{
+        ConfigDefaults::TELEGRAM_TRANSCODE_QUALITY,
+        ConfigDefaults::TRANSCODE_WIDTH};
+    int m_telegramVideoPartSizeMB{ConfigDefaults::VIDEO_PART_SIZE_MB};
 
     // Ntfy configuration
     std::string m_ntfyUrl{ConfigDefaults::NTFY_URL};
@@ -106,6 +204,9 @@ class Config {
     std::string m_ntfyPriority{ConfigDefaults::NTFY_PRIORITY};
     bool m_ntfyUploadScreenshots{ConfigDefaults::NTFY_UPLOAD_SCREENSHOTS};
     bool m_ntfyUploadMovies{ConfigDefaults::NTFY_UPLOAD_MOVIES};
+    TranscodeSettings m_ntfyTranscode{ConfigDefaults::NTFY_TRANSCODE_QUALITY,
+                                      ConfigDefaults::TRANSCODE_WIDTH};
+    int m_ntfyVideoPartSizeMB{ConfigDefaults::VIDEO_PART_SIZE_MB};
 
     // Discord configuration
     std::string m_discordBotToken{ConfigDefaults::DISCORD_BOT_TOKEN};
@@ -113,4 +214,8 @@ class Config {
     std::string m_discordApiUrl{ConfigDefaults::DISCORD_API_URL};
     bool m_discordUploadScreenshots{ConfigDefaults::DISCORD_UPLOAD_SCREENSHOTS};
     bool m_discordUploadMovies{ConfigDefaults::DISCORD_UPLOAD_MOVIES};
+    TranscodeSettings m_discordTranscode{
+        ConfigDefaults::DISCORD_TRANSCODE_QUALITY,
+        ConfigDefaults::TRANSCODE_WIDTH};
+    int m_discordVideoPartSizeMB{ConfigDefaults::VIDEO_PART_SIZE_MB};
 };
\ No newline at end of file
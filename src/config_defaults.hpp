@@ -12,6 +12,40 @@ constexpr std::string_view Original = "original";
 constexpr std::string_view Both = "both";
 }  // namespace UploadMode
 
+/**
+ * Album discovery backend constants
+ */
+namespace AlbumBackend {
+constexpr std::string_view Fs = "fs";        // Walk img:/YYYY/MM/DD dirs
+constexpr std::string_view Capsa = "capsa";  // Query the caps:a service
+}  // namespace AlbumBackend
+
+/**
+ * Capture detection mode constants
+ */
+namespace DetectionMode {
+constexpr std::string_view Poll = "poll";    // Check the album on a timer
+constexpr std::string_view Event = "event";  // Wake on capture button press
+}  // namespace DetectionMode
+
+/**
+ * Upload pacing mode constants
+ */
+namespace UploadPacing {
+constexpr std::string_view Off = "off";         // Always full speed
+constexpr std::string_view InGame = "in_game";  // Cap while a title runs
+constexpr std::string_view Always = "always";   // Always cap
+}  // namespace UploadPacing
+
+/**
+ * Transfer profile constants: socket and curl buffer sizes of one upload
+ */
+namespace TransferProfile {
+constexpr std::string_view Small = "small";    // Least heap, for screenshots
+constexpr std::string_view Medium = "medium";  // Larger send/upload buffers
+constexpr std::string_view Large = "large";    // Fastest on slow links
+}  // namespace TransferProfile
+
 /**
  * Configuration default values
  * This is the single source of truth for all default configuration values
@@ -23,8 +57,34 @@ namespace ConfigDefaults {
 // ============================================================================
 constexpr int CHECK_INTERVAL_SECONDS = 5;
 constexpr int CHECK_INTERVAL_MINIMUM = 1;
+// Idle ceiling the check interval backs off to when nothing is captured and
+// no title is running; never below check_interval
+constexpr int CHECK_INTERVAL_MAX_SECONDS = 60;
 constexpr bool KEEP_LOGS = false;
 constexpr std::string_view LOG_LEVEL = "info";  // debug, info, warn, error
+constexpr std::string_view ALBUM_BACKEND = AlbumBackend::Fs;
+constexpr std::string_view DETECTION_MODE = DetectionMode::Poll;
+// Screenshots found in one poll sent per Telegram media group / Discord
+// message; 10 is the limit of both APIs, 1 (the default) disables batching
+constexpr int BATCH_SIZE = 1;
+constexpr int BATCH_SIZE_MINIMUM = 1;
+constexpr int BATCH_SIZE_MAXIMUM = 10;
+constexpr std::string_view UPLOAD_PACING = UploadPacing::Off;
+// Upload rate cap in KB/s while pacing applies, shared by all channels
+constexpr int UPLOAD_RATE_LIMIT_KBPS = 256;
+constexpr int UPLOAD_RATE_LIMIT_MINIMUM = 16;
+constexpr bool DEFER_VIDEOS_IN_GAME = false;
+constexpr bool WRITE_STATS = false;
+constexpr bool SKIP_DUPLICATES = false;
+// Send the album thumbnail of a new recording before the video itself
+constexpr bool VIDEO_PREVIEW = false;
+constexpr std::string_view IMAGE_TRANSFER_PROFILE = TransferProfile::Small;
+constexpr std::string_view VIDEO_TRANSFER_PROFILE = TransferProfile::Medium;
+// Start sockets and curl only while uploading, stopping them once idle for
+// NETWORK_IDLE_TIMEOUT_SECONDS
+constexpr bool LAZY_NETWORK = false;
+constexpr int NETWORK_IDLE_TIMEOUT_SECONDS = 120;
+constexpr int NETWORK_IDLE_TIMEOUT_MINIMUM = 10;
 
 // ============================================================================
 // Upload destination toggles
@@ -42,6 +102,8 @@ constexpr std::string_view TELEGRAM_API_URL = "https://api.telegram.org";
 constexpr bool TELEGRAM_UPLOAD_SCREENSHOTS = true;
 constexpr bool TELEGRAM_UPLOAD_MOVIES = true;
 constexpr std::string_view TELEGRAM_UPLOAD_MODE = UploadMode::Compressed;
+// Re-encode screenshots sent as photos at this JPEG quality (0 = off)
+constexpr int TELEGRAM_TRANSCODE_QUALITY = 0;
 
 // ============================================================================
 // Ntfy configuration
@@ -52,6 +114,7 @@ constexpr std::string_view NTFY_TOKEN = "";
 constexpr std::string_view NTFY_PRIORITY = "default";
 constexpr bool NTFY_UPLOAD_SCREENSHOTS = true;
 constexpr bool NTFY_UPLOAD_MOVIES = false;
+constexpr int NTFY_TRANSCODE_QUALITY = 0;
 
 // ============================================================================
 // Discord configuration
@@ -61,6 +124,23 @@ constexpr std::string_view DISCORD_CHANNEL_ID = "";
 constexpr std::string_view DISCORD_API_URL = "https://discord.com/api/v10";
 constexpr bool DISCORD_UPLOAD_SCREENSHOTS = true;
 constexpr bool DISCORD_UPLOAD_MOVIES = false;
+constexpr int DISCORD_TRANSCODE_QUALITY = 0;
+
+// ============================================================================
+// Screenshot re-encoding (transcode_quality/transcode_width of every channel)
+// ============================================================================
+constexpr int TRANSCODE_QUALITY_MAXIMUM = 100;
+// Screenshots are 1280 wide; each channel scales down to at most this width
+constexpr int TRANSCODE_WIDTH = 960;
+constexpr int TRANSCODE_WIDTH_MINIMUM = 160;
+constexpr int TRANSCODE_WIDTH_MAXIMUM = 1280;
+
+// ============================================================================
+// Split video uploads (video_part_size of every channel)
+// ============================================================================
+// Send videos larger than this many MB as numbered parts (0 = never split)
+constexpr int VIDEO_PART_SIZE_MB = 0;
+constexpr int VIDEO_PART_SIZE_MB_MAXIMUM = 2000;
 
 // ============================================================================
 // Configuration validation utilities
@@ -75,6 +155,37 @@ constexpr bool isUploadModeValid(std::string_view mode) noexcept {
            mode == UploadMode::Both;
 }
 
+/**
+ * Check if album backend string is valid
+ */
+constexpr bool isAlbumBackendValid(std::string_view backend) noexcept {
+    return backend == AlbumBackend::Fs || backend == AlbumBackend::Capsa;
+}
+
+/**
+ * Check if detection mode string is valid
+ */
+constexpr bool isDetectionModeValid(std::string_view mode) noexcept {
+    return mode == DetectionMode::Poll || mode == DetectionMode::Event;
+}
+
+/**
+ * Check if upload pacing mode string is valid
+ */
+constexpr bool isUploadPacingValid(std::string_view mode) noexcept {
+    return mode == UploadPacing::Off || mode == UploadPacing::InGame ||
+           mode == UploadPacing::Always;
+}
+
+/**
+ * Check if transfer profile string is valid
+ */
+constexpr bool isTransferProfileValid(std::string_view profile) noexcept {
+    return profile == TransferProfile::Small ||
+           profile == TransferProfile::Medium ||
+           profile == TransferProfile::Large;
+}
+
 /**
  * Check if Telegram configuration is valid
  * Returns true if Telegram is properly configured
@@ -0,0 +1,185 @@
+#include "dedup.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "logger.hpp"
+#include "project.h"
+#include "utils.hpp"
+
+namespace {
+constexpr const char* DEDUP_PATH = "sdmc:/config/" APP_TITLE "/dedup.bin";
+constexpr const char* DEDUP_TMP_PATH = "sdmc:/config/" APP_TITLE "/dedup.tmp";
+
+// Bytes hashed from each end of a file. Album files carry their capture
+// time and title in the first block, so this is enough to tell them apart.
+constexpr size_t DEDUP_BLOCK_SIZE = 0x1000;
+
+// FNV-1a, fast and good enough for a few thousand keys
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+// One delivery, appended to the index file as is
+struct DedupRecord {
+    DedupKey key;
+    ChannelMask channels;
+    uint8_t reserved[7];
+};
+static_assert(sizeof(DedupRecord) == 16);
+
+// Shared by hashing and by reading the index, which never overlap
+alignas(DedupRecord) unsigned char g_buffer[DEDUP_BLOCK_SIZE];
+constexpr size_t BUFFER_RECORDS = sizeof(g_buffer) / sizeof(DedupRecord);
+
+size_t g_recordCount = 0;
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) noexcept {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Read `size` bytes at `offset` into g_buffer
+bool readBlock(FILE* f, size_t offset, size_t size) {
+    return std::fseek(f, static_cast<long>(offset), SEEK_SET) == 0 &&
+           std::fread(g_buffer, 1, size, f) == size;
+}
+
+// Rewrite the index with only its newest `keep` records. Also drops a
+// record torn by a crash mid-append.
+void compact(size_t keep) {
+    FILE* in = std::fopen(DEDUP_PATH, "rb");
+    if (!in) return;
+    FILE* out = std::fopen(DEDUP_TMP_PATH, "wb");
+    if (!out) {
+        std::fclose(in);
+        return;
+    }
+
+    keep = std::min(keep, g_recordCount);
+    bool ok = std::fseek(in, static_cast<long>((g_recordCount - keep) *
+                                               sizeof(DedupRecord)),
+                         SEEK_SET) == 0;
+    for (size_t left = keep; ok && left > 0;) {
+        const size_t count = std::min(left, BUFFER_RECORDS);
+        ok = std::fread(g_buffer, sizeof(DedupRecord), count, in) == count &&
+             std::fwrite(g_buffer, sizeof(DedupRecord), count, out) == count;
+        left -= count;
+    }
+    std::fclose(in);
+    std::fflush(out);
+    fsync(fileno(out));
+    std::fclose(out);
+
+    if (!ok) {
+        LOG_ERROR() << "[Dedup] Compaction failed" << endl;
+        std::remove(DEDUP_TMP_PATH);
+        return;
+    }
+
+    // FAT cannot rename over an existing file; dedupInit() recovers the tmp
+    // file if we crash in between
+    std::remove(DEDUP_PATH);
+    if (std::rename(DEDUP_TMP_PATH, DEDUP_PATH) != 0) {
+        LOG_ERROR() << "[Dedup] Compaction rename failed" << endl;
+        g_recordCount = 0;
+        return;
+    }
+    g_recordCount = keep;
+}
+}  // namespace
+
+void dedupInit() {
+    size_t bytes = filesize(DEDUP_PATH);
+    if (bytes == 0 && std::rename(DEDUP_TMP_PATH, DEDUP_PATH) == 0) {
+        bytes = filesize(DEDUP_PATH);
+    }
+
+    g_recordCount = bytes / sizeof(DedupRecord);
+    if (bytes % sizeof(DedupRecord) != 0) {
+        compact(g_recordCount);
+    }
+
+    LOG_INFO() << "[Dedup] " << g_recordCount << " delivered file(s) indexed"
+               << endl;
+}
+
+DedupKey dedupKey(const char* filePath, size_t fileSize) {
+    if (fileSize == 0) return 0;
+
+    FILE* f = std::fopen(filePath, "rb");
+    if (!f) return 0;
+
+    const uint64_t size = fileSize;
+    uint64_t hash = fnv1a(FNV_OFFSET_BASIS, &size, sizeof(size));
+
+    const size_t head = std::min(fileSize, DEDUP_BLOCK_SIZE);
+    bool ok = readBlock(f, 0, head);
+    hash = fnv1a(hash, g_buffer, head);
+    if (ok && fileSize > DEDUP_BLOCK_SIZE) {
+        const size_t tail = std::min(fileSize - DEDUP_BLOCK_SIZE,
+                                     DEDUP_BLOCK_SIZE);
+        ok = readBlock(f, fileSize - tail, tail);
+        hash = fnv1a(hash, g_buffer, tail);
+    }
+    std::fclose(f);
+
+    if (!ok) {
+        LOG_WARN() << "[Dedup] Failed to read " << filePath << endl;
+        return 0;
+    }
+    // 0 means "no key"
+    return hash != 0 ? hash : 1;
+}
+
+ChannelMask dedupDelivered(DedupKey key) {
+    if (key == 0 || g_recordCount == 0) return 0;
+
+    FILE* f = std::fopen(DEDUP_PATH, "rb");
+    if (!f) return 0;
+
+    // Every record of the key adds to what it was delivered to
+    ChannelMask delivered = 0;
+    size_t left = g_recordCount;
+    while (left > 0) {
+        const size_t count = std::min(left, BUFFER_RECORDS);
+        if (std::fread(g_buffer, sizeof(DedupRecord), count, f) != count) {
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            DedupRecord record;
+            std::memcpy(&record, &g_buffer[i * sizeof(DedupRecord)],
+                        sizeof(record));
+            if (record.key == key) delivered |= record.channels;
+        }
+        left -= count;
+    }
+    std::fclose(f);
+    return delivered;
+}
+
+void dedupRecord(DedupKey key, ChannelMask channels) {
+    if (key == 0 || channels == 0) return;
+
+    // Forget the older half once full, so compaction stays rare
+    if (g_recordCount >= DEDUP_MAX_RECORDS) {
+        compact(DEDUP_MAX_RECORDS / 2);
+    }
+
+    FILE* f = std::fopen(DEDUP_PATH, "ab");
+    if (!f) {
+        LOG_ERROR() << "[Dedup] Failed to open " << DEDUP_PATH << endl;
+        return;
+    }
+    const DedupRecord record{key, channels, {}};
+    const bool ok = std::fwrite(&record, sizeof(record), 1, f) == 1;
+    std::fflush(f);
+    fsync(fileno(f));
+    std::fclose(f);
+    if (ok) g_recordCount++;
+}
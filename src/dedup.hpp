@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "upload.hpp"
+
+// Index on SD of files already delivered, keyed by their content rather
+// than their path, so captures that come back after the album was restored
+// or moved between NAND and SD (or after the high-water mark was lost) are
+// not uploaded again. Only the newest DEDUP_MAX_RECORDS deliveries are
+// remembered. Only used by the upload worker thread after dedupInit().
+
+constexpr size_t DEDUP_MAX_RECORDS = 4096;
+
+// Content key of a file; 0 if it could not be read
+using DedupKey = uint64_t;
+
+// Recover the index file after a crash during compaction and count its
+// records (call once at startup, before the upload worker starts)
+void dedupInit();
+
+// Hash of the file size and its first and last blocks
+[[nodiscard]] DedupKey dedupKey(const char* filePath, size_t fileSize);
+
+// Channels a file with this key has already been delivered to
+[[nodiscard]] ChannelMask dedupDelivered(DedupKey key);
+
+// Remember that a file with this key was delivered to the given channels
+void dedupRecord(DedupKey key, ChannelMask channels);
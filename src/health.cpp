@@ -0,0 +1,86 @@
+#include "health.hpp"
+
+#include <switch.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "logger.hpp"
+
+namespace {
+struct ChannelHealth {
+    int consecutiveFailures;
+    char lastError[64];
+    u64 pausedUntilTick;  // 0 while the channel is healthy
+    uint64_t cooldownNs;
+};
+
+ChannelHealth g_health[UPLOAD_CHANNEL_COUNT];
+
+ChannelHealth& healthOf(UploadChannel channel) {
+    return g_health[static_cast<size_t>(channel)];
+}
+}  // namespace
+
+void healthRecordSuccess(UploadChannel channel) {
+    ChannelHealth& health = healthOf(channel);
+    if (health.pausedUntilTick != 0) {
+        LOG_INFO() << "[" << channelName(channel)
+                   << "] Channel recovered, resuming uploads" << endl;
+    }
+    health = ChannelHealth{};
+}
+
+void healthRecordFailure(UploadChannel channel, std::string_view error) {
+    ChannelHealth& health = healthOf(channel);
+    ++health.consecutiveFailures;
+
+    const size_t length = std::min(error.size(), sizeof(health.lastError) - 1);
+    std::memcpy(health.lastError, error.data(), length);
+    health.lastError[length] = '\0';
+
+    const bool probeFailed = health.pausedUntilTick != 0;
+    if (!probeFailed &&
+        health.consecutiveFailures < CHANNEL_FAILURE_THRESHOLD) {
+        return;
+    }
+
+    health.cooldownNs =
+        probeFailed ? std::min(health.cooldownNs * 2, CHANNEL_COOLDOWN_MAX_NS)
+                    : CHANNEL_COOLDOWN_NS;
+    health.pausedUntilTick =
+        armGetSystemTick() + armNsToTicks(health.cooldownNs);
+
+    LOG_WARN() << "[" << channelName(channel) << "] "
+               << health.consecutiveFailures
+               << " consecutive failures (last: " << health.lastError
+               << "), pausing for " << health.cooldownNs / 1'000'000'000ULL
+               << "s" << endl;
+}
+
+ChannelMask healthAvailableChannels() {
+    const u64 now = armGetSystemTick();
+    ChannelMask available = 0;
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        if (g_health[i].pausedUntilTick <= now) {
+            available |= channelBit(static_cast<UploadChannel>(i));
+        }
+    }
+    return available;
+}
+
+ChannelMask healthPausedChannels() {
+    ChannelMask paused = 0;
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        if (g_health[i].pausedUntilTick != 0) {
+            paused |= channelBit(static_cast<UploadChannel>(i));
+        }
+    }
+    return paused;
+}
+
+uint64_t healthProbeDelayNs(UploadChannel channel) {
+    const u64 now = armGetSystemTick();
+    const u64 until = healthOf(channel).pausedUntilTick;
+    return until > now ? armTicksToNs(until - now) : 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "upload.hpp"
+
+// Per-channel circuit breaker. A channel that fails several uploads in a row
+// is paused for a cooldown instead of being hammered by every queued file;
+// once the cooldown ends the next upload to it acts as a probe. Only used by
+// the upload worker thread.
+
+// Consecutive failures after which a channel is paused
+constexpr int CHANNEL_FAILURE_THRESHOLD = 3;
+
+// First cooldown, doubled after every failed probe up to the maximum
+constexpr uint64_t CHANNEL_COOLDOWN_NS = 30'000'000'000ULL;       // 30s
+constexpr uint64_t CHANNEL_COOLDOWN_MAX_NS = 600'000'000'000ULL;  // 10 min
+
+// Record the outcome of one request to a channel. Failures are problems with
+// the service itself (transport errors, 5xx, rate limiting); a request the
+// service answered and rejected still shows the channel is up.
+void healthRecordSuccess(UploadChannel channel);
+void healthRecordFailure(UploadChannel channel, std::string_view error);
+
+// Channels that may be sent to now: healthy ones and paused ones whose
+// cooldown has ended (their next request is the probe)
+[[nodiscard]] ChannelMask healthAvailableChannels();
+
+// Channels that are paused, including those whose probe is due
+[[nodiscard]] ChannelMask healthPausedChannels();
+
+// Nanoseconds until a paused channel may be probed (0 if it is available)
+[[nodiscard]] uint64_t healthProbeDelayNs(UploadChannel channel);
@@ -0,0 +1,194 @@
+#include "ini.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+
+namespace {
+constexpr std::string_view WHITESPACE = " \t\r";
+
+std::string_view trim(std::string_view s) noexcept {
+    const size_t first = s.find_first_not_of(WHITESPACE);
+    if (first == std::string_view::npos) return {};
+    const size_t last = s.find_last_not_of(WHITESPACE);
+    return s.substr(first, last - first + 1);
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const auto lower = [](char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a')
+                                          : c;
+        };
+        if (lower(a[i]) != lower(b[i])) return false;
+    }
+    return true;
+}
+
+// Strip a trailing comment and surrounding quotes from a value, unescaping
+// doubled quotes in place. `value` points into the writable file buffer.
+std::string_view cleanValue(char* value, size_t len) noexcept {
+    // Find the end of the value: the first ; or # outside quotes
+    bool quoted = false;
+    size_t end = 0;
+    for (; end < len; ++end) {
+        const char c = value[end];
+        if (c == '"') {
+            if (quoted && end + 1 < len && value[end + 1] == '"') {
+                ++end;
+            } else {
+                quoted = !quoted;
+            }
+        } else if (!quoted && (c == ';' || c == '#')) {
+            break;
+        }
+    }
+
+    std::string_view result = trim(std::string_view(value, end));
+    if (result.size() < 2 || result.front() != '"' || result.back() != '"') {
+        return result;
+    }
+
+    // Quoted value: drop the quotes and collapse "" to "
+    char* out = const_cast<char*>(result.data());
+    size_t outLen = 0;
+    for (size_t i = 1; i + 1 < result.size(); ++i) {
+        out[outLen++] = result[i];
+        if (result[i] == '"' && i + 2 < result.size() && result[i + 1] == '"') {
+            ++i;
+        }
+    }
+    return std::string_view(out, outLen);
+}
+}  // namespace
+
+bool IniFile::load(const char* path) {
+    m_text.reset();
+    m_entries.clear();
+
+    FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || st.st_size < 0) {
+        std::fclose(f);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    m_text = std::make_unique_for_overwrite<char[]>(size + 1);
+    const size_t read = std::fread(m_text.get(), 1, size, f);
+    std::fclose(f);
+    m_text[read] = '\0';
+
+    // Count lines first so the entry table is allocated exactly once
+    size_t lines = 1;
+    for (size_t i = 0; i < read; ++i) {
+        if (m_text[i] == '\n') ++lines;
+    }
+    m_entries.reserve(lines);
+
+    std::string_view section;
+    size_t pos = 0;
+    while (pos < read) {
+        size_t eol = pos;
+        while (eol < read && m_text[eol] != '\n') ++eol;
+        char* lineStart = m_text.get() + pos;
+        const std::string_view line =
+            trim(std::string_view(lineStart, eol - pos));
+        pos = eol + 1;
+
+        if (line.empty() || line.front() == ';' || line.front() == '#') {
+            continue;
+        }
+
+        if (line.front() == '[') {
+            const size_t close = line.find(']');
+            if (close != std::string_view::npos) {
+                section = trim(line.substr(1, close - 1));
+            }
+            continue;
+        }
+
+        const size_t sep = line.find_first_of("=:");
+        if (sep == std::string_view::npos) continue;
+
+        const std::string_view key = trim(line.substr(0, sep));
+        if (key.empty()) continue;
+
+        char* value = const_cast<char*>(line.data()) + sep + 1;
+        m_entries.push_back(
+            {section, key, cleanValue(value, line.size() - sep - 1)});
+    }
+
+    return true;
+}
+
+const IniFile::Entry* IniFile::find(std::string_view section,
+                                    std::string_view key) const noexcept {
+    for (const Entry& entry : m_entries) {
+        if (equalsIgnoreCase(entry.section, section) &&
+            equalsIgnoreCase(entry.key, key)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::string_view IniFile::getString(
+    std::string_view section, std::string_view key,
+    std::string_view defaultValue) const noexcept {
+    const Entry* entry = find(section, key);
+    if (!entry || entry->value.empty()) return defaultValue;
+    return entry->value;
+}
+
+bool IniFile::getBool(std::string_view section, std::string_view key,
+                      bool defaultValue) const noexcept {
+    const std::string_view value = getString(section, key, {});
+    if (value.empty()) return defaultValue;
+
+    switch (value.front()) {
+        case 'y':
+        case 'Y':
+        case 't':
+        case 'T':
+        case '1':
+            return true;
+        case 'n':
+        case 'N':
+        case 'f':
+        case 'F':
+        case '0':
+            return false;
+        case 'o':
+        case 'O':
+            if (value.size() >= 2) {
+                if (value[1] == 'n' || value[1] == 'N') return true;
+                if (value[1] == 'f' || value[1] == 'F') return false;
+            }
+            return defaultValue;
+        default:
+            return defaultValue;
+    }
+}
+
+long IniFile::getLong(std::string_view section, std::string_view key,
+                      long defaultValue) const noexcept {
+    const std::string_view value = getString(section, key, {});
+    if (value.empty()) return defaultValue;
+
+    // Values are views into the file buffer, not NUL-terminated
+    char buffer[32];
+    const size_t len = std::min(value.size(), sizeof(buffer) - 1);
+    value.copy(buffer, len);
+    buffer[len] = '\0';
+
+    const bool hex = len >= 2 && (buffer[1] == 'x' || buffer[1] == 'X');
+    return std::strtol(buffer, nullptr, hex ? 16 : 10);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Read-once INI file. The whole file is loaded into a single buffer and
+// parsed in one pass into section/key/value views into that buffer, so every
+// lookup afterwards is served from memory. Syntax follows minIni: [section]
+// headers, `key=value` or `key:value`, `;`/`#` comments, optional double
+// quotes around values, case-insensitive section and key names, first
+// occurrence wins.
+class IniFile {
+   public:
+    // Load and parse `path`, replacing anything loaded before.
+    // Returns false if the file cannot be read.
+    [[nodiscard]] bool load(const char* path);
+
+    // Value for section/key, or `defaultValue` if missing or empty
+    [[nodiscard]] std::string_view getString(
+        std::string_view section, std::string_view key,
+        std::string_view defaultValue) const noexcept;
+
+    // y/yes/t/true/1/on are true, n/no/f/false/0/off are false, anything
+    // else yields `defaultValue`
+    [[nodiscard]] bool getBool(std::string_view section, std::string_view key,
+                               bool defaultValue) const noexcept;
+
+    // Decimal, or hexadecimal with a 0x prefix
+    [[nodiscard]] long getLong(std::string_view section, std::string_view key,
+                               long defaultValue) const noexcept;
+
+   private:
+    struct Entry {
+        std::string_view section;
+        std::string_view key;
+        std::string_view value;
+    };
+
+    [[nodiscard]] const Entry* find(std::string_view section,
+                                    std::string_view key) const noexcept;
+
+    std::unique_ptr<char[]> m_text;
+    std::vector<Entry> m_entries;
+};
@@ -0,0 +1,437 @@
+#include "journal.hpp"
+
+#include <switch.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "logger.hpp"
+#include "project.h"
+
+namespace {
+constexpr const char* JOURNAL_PATH = "sdmc:/config/" APP_TITLE "/journal.txt";
+constexpr const char* JOURNAL_TMP_PATH =
+    "sdmc:/config/" APP_TITLE "/journal.tmp";
+
+// Rewrite the journal after this many appended records
+constexpr size_t JOURNAL_COMPACT_THRESHOLD = 64;
+// A rebuild splits the files into at most this many groups
+constexpr uint64_t MAX_REBUILD_GROUPS = 8;
+
+// FNV-1a of the path; plenty to tell a few thousand album paths apart
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+// Unfinished file in the in-memory mirror, 16 bytes instead of a full path
+struct MirrorEntry {
+    uint64_t key;  // pathKey() of the file
+    ChannelMask pending;
+    ChannelMask parked;  // Pending channels not queued anywhere else
+    bool derived;        // Made by the app, recorded as "D" instead of "E"
+    bool visited;        // Already handled by the file pass in progress
+    uint8_t attempts[UPLOAD_CHANNEL_COUNT];  // Of the parked channels
+};
+static_assert(sizeof(MirrorEntry) == 16);
+
+// In-memory mirror of the unfinished entries
+MirrorEntry g_entries[MAX_JOURNAL_ENTRIES];
+size_t g_entryCount = 0;
+bool g_overflow = false;  // Mirror incomplete: compaction would drop work
+char g_highWaterMark[128] = {};
+size_t g_recordsSinceCompact = 0;
+
+// Only files with pathKey() % g_groupCount == g_group are mirrored (all of
+// them, except while rebuild() runs)
+uint64_t g_groupCount = 1;
+uint64_t g_group = 0;
+
+Mutex g_journalMutex;
+
+uint64_t pathKey(std::string_view filePath) noexcept {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (const char c : filePath) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+bool inGroup(std::string_view filePath) noexcept {
+    return pathKey(filePath) % g_groupCount == g_group;
+}
+
+MirrorEntry* findEntry(std::string_view filePath) {
+    const uint64_t key = pathKey(filePath);
+    for (size_t i = 0; i < g_entryCount; ++i) {
+        if (g_entries[i].key == key) return &g_entries[i];
+    }
+    return nullptr;
+}
+
+// Drop an entry, keeping enqueue order for the remaining ones
+void removeEntry(MirrorEntry* entry) {
+    const size_t index = static_cast<size_t>(entry - g_entries);
+    std::memmove(&g_entries[index], &g_entries[index + 1],
+                 (g_entryCount - index - 1) * sizeof(MirrorEntry));
+    g_entryCount--;
+}
+
+void clearVisited() {
+    for (size_t i = 0; i < g_entryCount; ++i) {
+        g_entries[i].visited = false;
+    }
+}
+
+void copyPath(char (&dst)[128], std::string_view src) {
+    const size_t len = std::min(src.size(), sizeof(dst) - 1);
+    std::memcpy(dst, src.data(), len);
+    dst[len] = '\0';
+}
+
+// Apply an enqueue record to the mirror
+void applyEnqueue(std::string_view filePath, ChannelMask channels,
+                  bool derived) {
+    if (!derived && filePath > std::string_view(g_highWaterMark)) {
+        copyPath(g_highWaterMark, filePath);
+    }
+    if (!inGroup(filePath)) return;
+
+    if (MirrorEntry* entry = findEntry(filePath)) {
+        entry->pending |= channels;
+        return;
+    }
+    if (g_entryCount >= MAX_JOURNAL_ENTRIES) {
+        g_overflow = true;
+        return;
+    }
+
+    g_entries[g_entryCount++] =
+        MirrorEntry{pathKey(filePath), channels, 0, derived, false, {}};
+}
+
+// Apply a completion record to the mirror
+void applyComplete(std::string_view filePath, ChannelMask channels) {
+    MirrorEntry* entry = findEntry(filePath);
+    if (!entry) return;
+
+    entry->pending &= ~channels;
+    entry->parked &= entry->pending;
+    if (entry->pending == 0) removeEntry(entry);
+}
+
+// Append one line and make sure it reached the SD card
+void appendRecord(const char* line) {
+    FILE* f = std::fopen(JOURNAL_PATH, "a");
+    if (!f) {
+        LOG_ERROR() << "[Journal] Failed to open " << JOURNAL_PATH << endl;
+        return;
+    }
+    std::fputs(line, f);
+    std::fflush(f);
+    fsync(fileno(f));
+    std::fclose(f);
+    g_recordsSinceCompact++;
+}
+
+// Call `apply` with every complete line of the journal (without its
+// newline). Returns the number of lines.
+template <typename F>
+size_t forEachLine(F&& apply) {
+    FILE* f = std::fopen(JOURNAL_PATH, "r");
+    if (!f) return 0;
+
+    size_t lines = 0;
+    char line[192];
+    while (std::fgets(line, sizeof(line), f)) {
+        const size_t len = std::strlen(line);
+        // A line without newline was torn by a crash mid-write
+        if (len == 0 || line[len - 1] != '\n') continue;
+        apply(std::string_view(line, len - 1));
+        lines++;
+    }
+    std::fclose(f);
+    return lines;
+}
+
+// Parse "<number> " from the front of a record
+bool parseNumber(std::string_view& rest, size_t& value) {
+    char* end = nullptr;
+    value = std::strtoul(rest.data(), &end, 10);
+    if (end == rest.data() || *end != ' ') return false;
+    rest.remove_prefix(static_cast<size_t>(end - rest.data()) + 1);
+    return true;
+}
+
+// Parse "E <mask> <size> <path>" (or "D ..." for a derived file)
+bool parseEnqueue(std::string_view line, size_t& mask, size_t& size,
+                  std::string_view& filePath) {
+    if (line.size() < 3 || (line[0] != 'E' && line[0] != 'D') ||
+        line[1] != ' ') {
+        return false;
+    }
+    filePath = line.substr(2);
+    return parseNumber(filePath, mask) && parseNumber(filePath, size) &&
+           !filePath.empty();
+}
+
+// Apply one journal line; torn or unknown lines are ignored
+void replayLine(std::string_view line) {
+    if (line.size() < 3 || line[1] != ' ') return;
+    std::string_view rest = line.substr(2);
+
+    size_t mask = 0;
+    size_t size = 0;
+    switch (line[0]) {
+        case 'M':
+            if (rest > std::string_view(g_highWaterMark)) {
+                copyPath(g_highWaterMark, rest);
+            }
+            break;
+        case 'E':
+        case 'D':
+            if (parseEnqueue(line, mask, size, rest)) {
+                applyEnqueue(rest, static_cast<ChannelMask>(mask),
+                             line[0] == 'D');
+            }
+            break;
+        case 'C':
+            if (parseNumber(rest, mask) && !rest.empty()) {
+                applyComplete(rest, static_cast<ChannelMask>(mask));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Rebuild the mirror from the file, which has everything the mirror could
+// not hold. Its history may have had more files unfinished at once than the
+// mirror holds, so the files are replayed in groups by key, one pass each,
+// with more and smaller groups until they fit. Clears g_overflow once the
+// unfinished entries fit again. Parked channels are not in the file, so
+// their files wait for the next start.
+void rebuild() {
+    for (uint64_t groups = 1; groups <= MAX_REBUILD_GROUPS; groups *= 2) {
+        g_entryCount = 0;
+        g_overflow = false;
+        g_groupCount = groups;
+        for (g_group = 0; g_group < groups && !g_overflow; ++g_group) {
+            forEachLine(replayLine);
+        }
+        if (!g_overflow) break;
+    }
+    g_groupCount = 1;
+    g_group = 0;
+}
+
+// Rewrite the journal with only the unfinished entries. Their paths come
+// from the first enqueue record of each in the current file.
+void compact() {
+    if (g_overflow) {
+        rebuild();
+        if (g_overflow) {
+            // Try again once as many records have been added
+            g_recordsSinceCompact = 0;
+            return;
+        }
+    }
+
+    FILE* out = std::fopen(JOURNAL_TMP_PATH, "w");
+    if (!out) return;
+
+    if (g_highWaterMark[0] != '\0') {
+        std::fprintf(out, "M %s\n", g_highWaterMark);
+    }
+    clearVisited();
+    forEachLine([out](std::string_view line) {
+        size_t mask;
+        size_t size;
+        std::string_view filePath;
+        if (!parseEnqueue(line, mask, size, filePath)) return;
+
+        MirrorEntry* entry = findEntry(filePath);
+        if (!entry || entry->visited) return;
+        entry->visited = true;
+        std::fprintf(out, "%c %u %zu %.*s\n", entry->derived ? 'D' : 'E',
+                     static_cast<unsigned>(entry->pending), size,
+                     static_cast<int>(filePath.size()), filePath.data());
+    });
+    std::fflush(out);
+    fsync(fileno(out));
+    std::fclose(out);
+
+    // FAT cannot rename over an existing file; replay recovers the tmp file
+    // if we crash in between
+    std::remove(JOURNAL_PATH);
+    if (std::rename(JOURNAL_TMP_PATH, JOURNAL_PATH) != 0) {
+        LOG_ERROR() << "[Journal] Compaction rename failed" << endl;
+        return;
+    }
+    g_recordsSinceCompact = 0;
+
+    // An entry whose enqueue record never reached the file is not in it any
+    // more either
+    for (size_t i = g_entryCount; i > 0; --i) {
+        if (!g_entries[i - 1].visited) removeEntry(&g_entries[i - 1]);
+    }
+}
+
+void enqueue(const char* filePath, size_t fileSize, ChannelMask channels,
+             bool derived) {
+    char line[192];
+    std::snprintf(line, sizeof(line), "%c %u %zu %s\n", derived ? 'D' : 'E',
+                  static_cast<unsigned>(channels), fileSize, filePath);
+
+    mutexLock(&g_journalMutex);
+    applyEnqueue(filePath, channels, derived);
+    appendRecord(line);
+    mutexUnlock(&g_journalMutex);
+}
+}  // namespace
+
+size_t journalReplay(JournalResumeFn resume, std::string& highWaterMark) {
+    mutexInit(&g_journalMutex);
+    mutexLock(&g_journalMutex);
+
+    // A crash during compaction leaves only the rewritten file
+    if (FILE* f = std::fopen(JOURNAL_PATH, "r")) {
+        std::fclose(f);
+    } else {
+        std::rename(JOURNAL_TMP_PATH, JOURNAL_PATH);
+    }
+
+    const size_t records = forEachLine(replayLine);
+    compact();
+    highWaterMark = g_highWaterMark;
+
+    // Hand out the unfinished entries in enqueue order, with the paths the
+    // file has for them
+    size_t unfinished = 0;
+    bool gone = false;
+    clearVisited();
+    forEachLine([&](std::string_view line) {
+        size_t mask;
+        size_t size;
+        std::string_view filePath;
+        if (!parseEnqueue(line, mask, size, filePath)) return;
+
+        MirrorEntry* entry = findEntry(filePath);
+        if (!entry || entry->visited) return;
+        entry->visited = true;
+        unfinished++;
+
+        JournalEntry resumed{};
+        copyPath(resumed.filePath, filePath);
+        resumed.fileSize = size;
+        resumed.pending = entry->pending;
+        if (!resume(resumed)) {
+            entry->pending = 0;
+            gone = true;
+        }
+    });
+
+    // Drop the entries of files that are gone for good
+    if (gone) {
+        for (size_t i = g_entryCount; i > 0; --i) {
+            if (g_entries[i - 1].pending == 0) removeEntry(&g_entries[i - 1]);
+        }
+        compact();
+    }
+
+    LOG_INFO() << "[Journal] Replayed " << records << " record(s), "
+               << unfinished << " unfinished item(s)" << endl;
+
+    mutexUnlock(&g_journalMutex);
+    return unfinished;
+}
+
+void journalEnqueue(const char* filePath, size_t fileSize,
+                    ChannelMask channels) {
+    enqueue(filePath, fileSize, channels, false);
+}
+
+void journalEnqueueDerived(const char* filePath, size_t fileSize,
+                           ChannelMask channels) {
+    enqueue(filePath, fileSize, channels, true);
+}
+
+bool journalComplete(const char* filePath, ChannelMask channels) {
+    if (channels == 0) return false;
+
+    char line[192];
+    std::snprintf(line, sizeof(line), "C %u %s\n",
+                  static_cast<unsigned>(channels), filePath);
+
+    mutexLock(&g_journalMutex);
+    applyComplete(filePath, channels);
+    const bool finished = !g_overflow && !findEntry(filePath);
+    appendRecord(line);
+    if (g_recordsSinceCompact >= JOURNAL_COMPACT_THRESHOLD) {
+        compact();
+    }
+    mutexUnlock(&g_journalMutex);
+    return finished;
+}
+
+bool journalIsPending(const char* filePath) {
+    mutexLock(&g_journalMutex);
+    const bool pending = g_overflow || findEntry(filePath);
+    mutexUnlock(&g_journalMutex);
+    return pending;
+}
+
+bool journalPark(const char* filePath, ChannelMask channels,
+                 const uint8_t* attempts) {
+    mutexLock(&g_journalMutex);
+    MirrorEntry* entry = findEntry(filePath);
+    if (entry) {
+        entry->parked |= channels & entry->pending;
+        for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+            if (channels & (1u << i)) entry->attempts[i] = attempts[i];
+        }
+    }
+    mutexUnlock(&g_journalMutex);
+    return entry != nullptr;
+}
+
+ChannelMask journalUnpark(ChannelMask channels, size_t limit,
+                          JournalUnparkFn unpark) {
+    mutexLock(&g_journalMutex);
+
+    // The paths come from the enqueue records, as on replay
+    size_t taken = 0;
+    bool stopped = false;
+    clearVisited();
+    forEachLine([&](std::string_view line) {
+        if (stopped || taken >= limit) return;
+
+        size_t mask;
+        size_t size;
+        std::string_view filePath;
+        if (!parseEnqueue(line, mask, size, filePath)) return;
+
+        MirrorEntry* entry = findEntry(filePath);
+        if (!entry || entry->visited || !(entry->parked & channels)) return;
+        entry->visited = true;
+
+        JournalEntry parked{};
+        copyPath(parked.filePath, filePath);
+        parked.fileSize = size;
+        parked.pending = entry->parked & channels;
+        std::memcpy(parked.attempts, entry->attempts, sizeof(parked.attempts));
+
+        const ChannelMask took = unpark(parked) & parked.pending;
+        entry->parked &= ~took;
+        if (took != parked.pending) stopped = true;
+        taken++;
+    });
+
+    ChannelMask stillParked = 0;
+    for (size_t i = 0; i < g_entryCount; ++i) {
+        stillParked |= g_entries[i].parked;
+    }
+    mutexUnlock(&g_journalMutex);
+    return stillParked;
+}
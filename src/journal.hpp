@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "retry.hpp"
+#include "upload.hpp"
+
+// Crash-safe, append-only upload journal on SD. Every queued (file, channel)
+// pair is recorded when it is enqueued and again once it is finished, so
+// after a reboot the unfinished work can be resumed without uploading
+// anything twice or rescanning the whole album. Only a hash of each path is
+// kept in memory; compaction takes the paths from the file itself.
+
+// Unfinished files tracked at once: everything the queue (with its spill
+// files), the retry queue and the worker can hold. Beyond that the journal
+// keeps growing until enough of them finish.
+constexpr size_t MAX_JOURNAL_ENTRIES =
+    MAX_QUEUED_TASKS + MAX_RETRY_ENTRIES + MAX_BATCH_SIZE;
+
+// A file with channels that have not finished yet
+struct JournalEntry {
+    char filePath[128];
+    size_t fileSize;
+    ChannelMask pending;
+    uint8_t attempts[UPLOAD_CHANNEL_COUNT];  // Failed attempts per channel
+};
+
+// Called with every unfinished entry on replay. Returns false if the file is
+// gone, which completes the entry.
+using JournalResumeFn = bool (*)(const JournalEntry& entry);
+
+// Replay the journal (call once at startup, before any other journal call).
+// Compacts the file, passes every unfinished entry to `resume` in enqueue
+// order and fills the newest enqueued path (high-water mark).
+// Returns the number of unfinished entries.
+size_t journalReplay(JournalResumeFn resume, std::string& highWaterMark);
+
+// Record that an album file was queued for the given channels
+void journalEnqueue(const char* filePath, size_t fileSize,
+                    ChannelMask channels);
+
+// Record that a file made by the app itself (a video preview) was queued.
+// Only album paths move the high-water mark, since detection resumes from
+// it.
+void journalEnqueueDerived(const char* filePath, size_t fileSize,
+                           ChannelMask channels);
+
+// Record that the given channels are done with a file (delivered, skipped
+// or given up after all retries). Returns true if no channel is left for it.
+bool journalComplete(const char* filePath, ChannelMask channels);
+
+// True if some channel still has to take the file (also while the journal
+// cannot tell, after its mirror overflowed)
+[[nodiscard]] bool journalIsPending(const char* filePath);
+
+// Record that the given channels of a file now wait in the journal alone,
+// not in the queue or the retry queue, with the attempts they have used.
+// Kept in memory only: after a reboot the file is resumed like any other
+// unfinished one. Returns false if the mirror does not hold the file.
+[[nodiscard]] bool journalPark(const char* filePath, ChannelMask channels,
+                 const uint8_t* attempts);
+
+// Called by journalUnpark() with the parked channels of a file. Returns the
+// channels it took.
+using JournalUnparkFn = ChannelMask (*)(const JournalEntry& entry);
+
+// Pass up to `limit` files parked for any of `channels` to `unpark`, in
+// enqueue order, stopping at the first file it does not take in full.
+// Returns the channels that still have parked files.
+ChannelMask journalUnpark(ChannelMask channels, size_t limit,
+                          JournalUnparkFn unpark);
@@ -0,0 +1,68 @@
+#include "logger.hpp"
+
+#include <switch.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+char g_logBuffer[LOG_BUFFER_SIZE];
+}  // namespace
+
+void Logger::truncate() {
+    rmutexLock(&m_mutex);
+    m_used = 0;
+    FILE* f = std::fopen(LOGFILE_PATH.data(), "w");
+    if (f) std::fclose(f);
+    rmutexUnlock(&m_mutex);
+}
+
+void Logger::close() {
+    rmutexLock(&m_mutex);
+    flushLocked();
+    rmutexUnlock(&m_mutex);
+}
+
+uint64_t Logger::flushIfDue() {
+    rmutexLock(&m_mutex);
+    uint64_t dueNs = UINT64_MAX;
+    if (m_used > 0) {
+        const uint64_t elapsedNs =
+            armTicksToNs(armGetSystemTick() - m_lastFlushTick);
+        if (elapsedNs >= LOG_FLUSH_INTERVAL_NS) {
+            flushLocked();
+        } else {
+            dueNs = LOG_FLUSH_INTERVAL_NS - elapsedNs;
+        }
+    }
+    rmutexUnlock(&m_mutex);
+    return dueNs;
+}
+
+void Logger::append(const char* data, size_t len) {
+    while (len > 0) {
+        if (m_used == LOG_BUFFER_SIZE) {
+            flushLocked();
+        }
+        const size_t chunk = std::min(len, LOG_BUFFER_SIZE - m_used);
+        std::memcpy(g_logBuffer + m_used, data, chunk);
+        m_used += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+void Logger::flushLocked() {
+    m_lastFlushTick = armGetSystemTick();
+    if (m_used == 0) return;
+
+    FILE* file = std::fopen(LOGFILE_PATH.data(), "a");
+    if (file) {
+        // Already batched, bypass stdio's own buffer
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        std::fwrite(g_logBuffer, 1, m_used, file);
+        std::fclose(file);
+    }
+    m_used = 0;
+}
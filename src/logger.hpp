@@ -1,6 +1,10 @@
 #pragma once
 
-#include <array>
+#include <switch.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -19,6 +23,20 @@ enum class LogLevel : uint8_t {
     NONE = 10,
 };
 
+// Lowest level compiled into the binary (LOG_LEVEL_MIN CMake option).
+// Messages below it are removed together with their arguments when logged
+// through the LOG_* macros below.
+#ifndef LOG_LEVEL_MIN
+#define LOG_LEVEL_MIN 0
+#endif
+
+inline constexpr LogLevel COMPILED_LOG_LEVEL =
+    static_cast<LogLevel>(LOG_LEVEL_MIN);
+
+[[nodiscard]] constexpr bool isLogCompiled(LogLevel level) noexcept {
+    return std::to_underlying(level) >= std::to_underlying(COMPILED_LOG_LEVEL);
+}
+
 // Custom end-of-line marker to avoid iostream dependency
 struct EndLine {};
 inline constexpr EndLine endl{};
@@ -26,25 +44,32 @@ inline constexpr EndLine endl{};
 inline constexpr std::string_view LOGFILE_PATH =
     "sdmc:/config/" APP_TITLE "/logs.txt";
 
+// Log lines are collected in a fixed in-memory buffer and written to SD in
+// batches: when the buffer fills up, after an ERROR line, or once
+// LOG_FLUSH_INTERVAL_NS has passed (see Logger::flushIfDue). The buffer is a
+// static array outside the newlib heap, so logging never competes with
+// uploads for INNER_HEAP_SIZE and its cost is fixed at LOG_BUFFER_SIZE bytes.
+inline constexpr size_t LOG_BUFFER_SIZE = 0x2000;  // 8KB
+inline constexpr uint64_t LOG_FLUSH_INTERVAL_NS = 5'000'000'000ULL;
+
 // Forward declaration
 class Logger;
 
 // Lightweight string builder for log messages
 class LogMessage {
    public:
-    // Constructor for enabled logs
-    LogMessage(FILE* file, const char* prefix) noexcept : m_file(file) {
-        if (m_file && prefix) {
-            std::fputs(prefix, m_file);
-        }
-    }
+    // Constructor for enabled logs; the lock is held (already acquired by
+    // Logger) until the message is complete so lines from the detection and
+    // upload threads never interleave
+    LogMessage(Logger* logger, LogLevel level) noexcept;
 
     // Default constructor for disabled logs
-    LogMessage() noexcept : m_file(nullptr) {}
+    LogMessage() noexcept : m_logger(nullptr), m_level(LogLevel::NONE) {}
 
     // Move constructor
-    LogMessage(LogMessage&& other) noexcept : m_file(other.m_file) {
-        other.m_file = nullptr;
+    LogMessage(LogMessage&& other) noexcept
+        : m_logger(other.m_logger), m_level(other.m_level) {
+        other.m_logger = nullptr;
     }
 
     // Delete copy operations
@@ -52,25 +77,15 @@ class LogMessage {
     LogMessage& operator=(const LogMessage&) = delete;
     LogMessage& operator=(LogMessage&&) = delete;
 
-    ~LogMessage() {
-        // Close file after each message
-        if (m_file) {
-            std::fflush(m_file);
-            std::fclose(m_file);
-            m_file = nullptr;
-        }
-    }
-
-    friend class Logger;  // Allow Logger to access our private members if
-                          // needed
+    ~LogMessage();
 
     LogMessage& operator<<(const char* str) {
-        if (m_file && str) std::fputs(str, m_file);
+        if (str) append(str, std::strlen(str));
         return *this;
     }
 
     LogMessage& operator<<(std::string_view str) {
-        if (m_file) std::fwrite(str.data(), 1, str.size(), m_file);
+        append(str.data(), str.size());
         return *this;
     }
 
@@ -81,21 +96,20 @@ class LogMessage {
     // Use concepts to handle all signed integral types
     template <std::signed_integral T>
     LogMessage& operator<<(T val) {
-        if (m_file) std::fprintf(m_file, "%lld", static_cast<long long>(val));
+        if (m_logger) format("%lld", static_cast<long long>(val));
         return *this;
     }
 
     // Use concepts to handle all unsigned integral types
     template <std::unsigned_integral T>
     LogMessage& operator<<(T val) {
-        if (m_file)
-            std::fprintf(m_file, "%llu", static_cast<unsigned long long>(val));
+        if (m_logger) format("%llu", static_cast<unsigned long long>(val));
         return *this;
     }
 
     template <std::floating_point T>
     LogMessage& operator<<(T val) {
-        if (m_file) std::fprintf(m_file, "%.6f", static_cast<double>(val));
+        if (m_logger) format("%.6f", static_cast<double>(val));
         return *this;
     }
 
@@ -105,16 +119,25 @@ class LogMessage {
 
     // Support for custom endl marker (avoids iostream dependency)
     LogMessage& operator<<(EndLine) {
-        if (m_file) {
-            std::fputc('\n', m_file);
-            std::fflush(m_file);
-            // File will be closed in destructor
-        }
+        append("\n", 1);
         return *this;
     }
 
    private:
-    FILE* m_file;
+    void append(const char* data, size_t len);
+
+    template <typename T>
+    void format(const char* fmt, T val) {
+        char buffer[32];
+        const int len = std::snprintf(buffer, sizeof(buffer), fmt, val);
+        if (len > 0) {
+            append(buffer, std::min(static_cast<size_t>(len),
+                                    sizeof(buffer) - 1));
+        }
+    }
+
+    Logger* m_logger;
+    LogLevel m_level;
 };
 
 class Logger {
@@ -126,16 +149,19 @@ class Logger {
 
     ~Logger() = default;
 
-    void truncate() {
-        FILE* f = std::fopen(LOGFILE_PATH.data(), "w");
-        if (f) std::fclose(f);
-    }
+    // Drop anything still buffered and empty the log file
+    void truncate();
 
     constexpr void setLevel(LogLevel level) noexcept { m_level = level; }
 
-    void close() {
-        // No-op: files are opened and closed per log message
-    }
+    // Write buffered lines to SD
+    void close();
+
+    // Write buffered lines if LOG_FLUSH_INTERVAL_NS passed since the last
+    // write. Returns the nanoseconds until the lines still buffered are due
+    // (UINT64_MAX if none are), so the detection loop and the upload worker
+    // can wake up for them instead of leaving them buffered while they sleep.
+    uint64_t flushIfDue();
 
     [[nodiscard]] constexpr bool isEnabled(LogLevel level) const noexcept {
         return std::to_underlying(level) >= std::to_underlying(m_level);
@@ -143,92 +169,110 @@ class Logger {
 
     LogMessage debug() {
         if (isEnabled(LogLevel::DEBUG)) {
-            FILE* file = std::fopen(LOGFILE_PATH.data(), "a");
-            if (file) {
-                std::setvbuf(file, nullptr, _IONBF, 0);
-            }
-            return LogMessage(file, getPrefix(LogLevel::DEBUG));
+            return open(LogLevel::DEBUG);
         }
         return LogMessage();
     }
 
     LogMessage info() {
         if (isEnabled(LogLevel::INFO)) {
-            FILE* file = std::fopen(LOGFILE_PATH.data(), "a");
-            if (file) {
-                std::setvbuf(file, nullptr, _IONBF, 0);
-            }
-            return LogMessage(file, getPrefix(LogLevel::INFO));
+            return open(LogLevel::INFO);
         }
         return LogMessage();
     }
 
     LogMessage warn() {
         if (isEnabled(LogLevel::WARN)) {
-            FILE* file = std::fopen(LOGFILE_PATH.data(), "a");
-            if (file) {
-                std::setvbuf(file, nullptr, _IONBF, 0);
-            }
-            return LogMessage(file, getPrefix(LogLevel::WARN));
+            return open(LogLevel::WARN);
         }
         return LogMessage();
     }
 
     LogMessage error() {
         if (isEnabled(LogLevel::ERROR)) {
-            FILE* file = std::fopen(LOGFILE_PATH.data(), "a");
-            if (file) {
-                std::setvbuf(file, nullptr, _IONBF, 0);
-            }
-            return LogMessage(file, getPrefix(LogLevel::ERROR));
+            return open(LogLevel::ERROR);
         }
         return LogMessage();
     }
 
     LogMessage none() {
         if (isEnabled(LogLevel::NONE)) {
-            FILE* file = std::fopen(LOGFILE_PATH.data(), "a");
-            if (file) {
-                std::setvbuf(file, nullptr, _IONBF, 0);
-            }
-            return LogMessage(file, getPrefix(LogLevel::NONE));
+            return open(LogLevel::NONE);
         }
         return LogMessage();
     }
 
    private:
+    friend class LogMessage;
+
     Logger() = default;
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
-    static const char* getPrefix(LogLevel lvl) {
-        static std::array<char, 64> buffer{};
+    // Lock the log for one message
+    LogMessage open(LogLevel lvl) {
+        rmutexLock(&m_mutex);
+        return LogMessage(this, lvl);
+    }
 
-        const char* level_str;
+    // Called with m_mutex held
+    void append(const char* data, size_t len);
+    void flushLocked();
+    void unlock() { rmutexUnlock(&m_mutex); }
+
+    static const char* getPrefix(LogLevel lvl) {
         switch (lvl) {
             case LogLevel::DEBUG:
-                level_str = "[DEBUG] ";
-                break;
+                return "[DEBUG] ";
             case LogLevel::INFO:
-                level_str = "[INFO ] ";
-                break;
+                return "[INFO ] ";
             case LogLevel::WARN:
-                level_str = "[WARN ] ";
-                break;
+                return "[WARN ] ";
             case LogLevel::ERROR:
-                level_str = "[ERROR] ";
-                break;
+                return "[ERROR] ";
             case LogLevel::NONE:
-                level_str = "";
-                break;
+                return "";
             default:
-                level_str = "[     ] ";
-                break;
+                return "[     ] ";
         }
-
-        std::snprintf(buffer.data(), buffer.size(), "%s", level_str);
-        return buffer.data();
     }
 
     LogLevel m_level{LogLevel::INFO};
+    RMutex m_mutex{};
+    size_t m_used{0};
+    uint64_t m_lastFlushTick{0};
 };
+
+inline LogMessage::LogMessage(Logger* logger, LogLevel level) noexcept
+    : m_logger(logger), m_level(level) {
+    const char* prefix = Logger::getPrefix(level);
+    append(prefix, std::strlen(prefix));
+}
+
+inline LogMessage::~LogMessage() {
+    if (m_logger) {
+        // Errors are written out immediately so they survive a crash
+        if (m_level == LogLevel::ERROR) {
+            m_logger->flushLocked();
+        }
+        m_logger->unlock();
+        m_logger = nullptr;
+    }
+}
+
+inline void LogMessage::append(const char* data, size_t len) {
+    if (m_logger) m_logger->append(data, len);
+}
+
+// Log statement macros: `LOG_INFO() << "x: " << x << endl;`. Unlike
+// Logger::get().info(), the arguments are only evaluated when the level is
+// both compiled in and enabled at runtime.
+#define LOG_AT(level, method)                                            \
+    if (!(isLogCompiled(level) && Logger::get().isEnabled(level))) {     \
+    } else                                                               \
+        Logger::get().method()
+
+#define LOG_DEBUG() LOG_AT(LogLevel::DEBUG, debug)
+#define LOG_INFO() LOG_AT(LogLevel::INFO, info)
+#define LOG_WARN() LOG_AT(LogLevel::WARN, warn)
+#define LOG_ERROR() LOG_AT(LogLevel::ERROR, error)
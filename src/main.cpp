@@ -1,29 +1,30 @@
-#include <curl/curl.h>
 #include <dirent.h>
 #include <switch.h>
 
+#include <algorithm>
 #include <cstring>
+#include <expected>
+#include <string>
 #include <string_view>
 
+#include "activity.hpp"
 #include "album.hpp"
 #include "config.hpp"
+#include "dedup.hpp"
+#include "journal.hpp"
 #include "logger.hpp"
+#include "memory.hpp"
+#include "network.hpp"
+#include "preview.hpp"
 #include "project.h"
 #include "queue.hpp"
 #include "upload.hpp"
 #include "utils.hpp"
+#include "worker.hpp"
 
 namespace {
 // Reduce heap size for memory optimization
 constexpr size_t INNER_HEAP_SIZE = 0x50000;  // 320KB
-
-constexpr size_t TCP_TX_BUF_SIZE = 0x800;
-constexpr size_t TCP_RX_BUF_SIZE = 0x1000;
-constexpr size_t TCP_TX_BUF_SIZE_MAX = 0x2EE0;
-constexpr size_t TCP_RX_BUF_SIZE_MAX = 0x2EE0;
-constexpr size_t UDP_TX_BUF_SIZE = 0;
-constexpr size_t UDP_RX_BUF_SIZE = 0;
-constexpr size_t SB_EFFICIENCY = 4;
 }  // namespace
 
 extern "C" {
@@ -75,19 +76,8 @@ void __appInit(void) {
         fatalThrow(rc);
     }
 
-    constexpr SocketInitConfig socket_config = {
-        .tcp_tx_buf_size = TCP_TX_BUF_SIZE,
-        .tcp_rx_buf_size = TCP_RX_BUF_SIZE,
-        .tcp_tx_buf_max_size = TCP_TX_BUF_SIZE_MAX,
-        .tcp_rx_buf_max_size = TCP_RX_BUF_SIZE_MAX,
-
-        .udp_tx_buf_size = UDP_TX_BUF_SIZE,
-        .udp_rx_buf_size = UDP_RX_BUF_SIZE,
-
-        .sb_efficiency = SB_EFFICIENCY,
-    };
-
-    rc = socketInitialize(&socket_config);
+    // Used to tell whether a title is running when pacing album checks
+    rc = pmdmntInitialize();
     if (R_FAILED(rc)) {
         fatalThrow(rc);
     }
@@ -104,26 +94,23 @@ void __appInit(void) {
 
     fsdevMountSdmc();
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // Sockets and curl are started by the upload worker (see network.hpp)
 }
 
 void __appExit(void) {
-    curl_global_cleanup();
+    captureEventExit();
+    networkDown();
     fsdevUnmountAll();
     fsExit();
     capsaExit();
+    pmdmntExit();
     nsExit();
-    socketExit();
     smExit();
 }
 }
 
-void initLogger(bool truncate) {
-    if (truncate) {
-        Logger::get().truncate();
-    }
-
-    // Set log level from configuration
+// Set log level from configuration
+void applyLogLevel() {
     std::string_view logLevelStr = Config::get().getLogLevel();
     if (logLevelStr == "debug") {
         Logger::get().setLevel(LogLevel::DEBUG);
@@ -134,115 +121,102 @@ void initLogger(bool truncate) {
     } else if (logLevelStr == "error") {
         Logger::get().setLevel(LogLevel::ERROR);
     }
-
-    constexpr std::string_view separator = "=============================";
-    auto logger = Logger::get().none();
-    logger << separator << endl;
-    logger << APP_TITLE " v" << APP_VERSION << " is starting..." << endl;
-    logger << separator << endl;
 }
 
-// Exponential backoff delay helper (1s, 2s, 4s...)
-inline void exponentialBackoff(int retryCount) {
-    const u64 delayMs = (1ULL << retryCount) * 1000ULL;
-    svcSleepThread(delayMs * 1'000'000ULL);
-}
+// Configure album checks from configuration, subscribing to capture button
+// presses if event detection is enabled
+void applyDetectionMode(PollScheduler& scheduler) {
+    const Config& config = Config::get();
+    bool eventDriven = false;
+    if (config.getDetectionMode() == DetectionMode::Event) {
+        eventDriven = captureEventInit();
+        if (!eventDriven) {
+            LOG_WARN() << "Capture button events unavailable, falling back "
+                          "to polling"
+                       << endl;
+        }
+    } else {
+        captureEventExit();
+    }
 
-// Process upload queue
-void processUploadQueue() {
-    // Get config values once
-    const std::string_view telegramUploadMode =
-        Config::get().getTelegramUploadMode();
-    const bool telegramEnabled = Config::get().telegramEnabled();
-    const bool ntfyEnabled = Config::get().ntfyEnabled();
-    const bool discordEnabled = Config::get().discordEnabled();
+    scheduler.configure(config.getCheckIntervalSeconds(),
+                        config.getCheckIntervalMaxSeconds(), eventDriven);
+    LOG_INFO() << "Detection: " << (eventDriven ? "event" : "poll")
+               << ", check interval: " << config.getCheckIntervalSeconds()
+               << "-" << config.getCheckIntervalMaxSeconds() << " second(s)"
+               << endl;
+}
 
-    // Process all tasks in queue until empty
+// Sleep until the next album check is due or the capture button is pressed
+void waitForNextCheck(PollScheduler& scheduler, u64 timeoutNs) {
+    // Wake up in between to write buffered log lines on time (the wait can
+    // last a minute in event mode)
+    const u64 startTick = armGetSystemTick();
     while (true) {
-        char filePath[128];
-        size_t fileSize = 0;
-
-        // Try to get a task from the queue
-        if (!queueGet(filePath, sizeof(filePath), fileSize)) {
-            break;  // Queue empty, exit
+        const u64 flushNs = Logger::get().flushIfDue();
+        const u64 elapsedNs = armTicksToNs(armGetSystemTick() - startTick);
+        if (elapsedNs >= timeoutNs) return;
+
+        if (captureEventWait(std::min(timeoutNs - elapsedNs, flushNs))) {
+            LOG_DEBUG() << "Capture button pressed" << endl;
+            scheduler.onCaptureButton();
+            return;
         }
+    }
+}
 
-        // Determine max retries based on file type
-        const bool isVideo = isVideoFile(filePath);
-        const int maxRetries = getMaxRetries(isVideo);
-
-        Logger::get().info() << "Uploading: " << filePath << " (" << fileSize
-                             << " bytes, " << (isVideo ? "video" : "image")
-                             << ", max " << maxRetries << " retries)" << endl;
+// Queue the thumbnail of a newly queued recording, for the channels that
+// will get the video. It still goes out first: screenshots are served ahead
+// of videos.
+void queuePreview(const char* moviePath, ChannelMask channels, uint32_t pollId,
+                  u64 detectTick) {
+    channels = previewChannels(channels);
+    if (channels == 0) return;
 
-        bool anySuccess = false;
+    char previewPath[PREVIEW_PATH_MAX];
+    bool created;
+    {
+        MemoryScope scope(MemorySubsystem::Album);
+        created = previewCreate(moviePath, previewPath);
+    }
+    if (!created) return;
 
-        // Upload to Telegram with exponential backoff
-        if (telegramEnabled) {
-            bool sent = false;
-            for (int retry = 0; retry < maxRetries && !sent; ++retry) {
-                if (retry > 0) {
-                    Logger::get().info() << "[Telegram] Retry " << retry << "/"
-                                         << maxRetries << endl;
-                    exponentialBackoff(retry - 1);
-                }
-                if (telegramUploadMode == UploadMode::Compressed) {
-                    sent = sendFileToTelegram(filePath, fileSize, true);
-                } else if (telegramUploadMode == UploadMode::Original) {
-                    sent = sendFileToTelegram(filePath, fileSize, false);
-                } else if (telegramUploadMode == UploadMode::Both) {
-                    bool c = sendFileToTelegram(filePath, fileSize, true);
-                    bool o = sendFileToTelegram(filePath, fileSize, false);
-                    sent = c || o;
-                }
-            }
-            if (sent)
-                anySuccess = true;
-            else
-                Logger::get().error() << "[Telegram] Upload failed after "
-                                      << maxRetries << " attempts" << endl;
-        }
+    const size_t size = filesize(previewPath);
+    journalEnqueueDerived(previewPath, size, channels);
+    if (queueAdd(previewPath, size, channels, pollId, detectTick)) {
+        LOG_INFO() << "Preview: " << previewPath << endl;
+    } else {
+        LOG_WARN() << "Queue full, leaving in journal: " << previewPath
+                   << endl;
+    }
+}
 
-        // Upload to ntfy with exponential backoff
-        if (ntfyEnabled) {
-            bool sent = false;
-            for (int retry = 0; retry < maxRetries && !sent; ++retry) {
-                if (retry > 0) {
-                    Logger::get().info() << "[ntfy] Retry " << retry << "/"
-                                         << maxRetries << endl;
-                    exponentialBackoff(retry - 1);
-                }
-                sent = sendFileToNtfy(filePath, fileSize);
-            }
-            if (sent)
-                anySuccess = true;
-            else
-                Logger::get().error() << "[ntfy] Upload failed after "
-                                      << maxRetries << " attempts" << endl;
-        }
+// Queue an unfinished entry of the journal again. Returns false if the file
+// was deleted since it was queued.
+bool resumeJournalEntry(const JournalEntry& entry) {
+    if (filesize(entry.filePath) == 0) return false;
 
-        // Upload to Discord with exponential backoff
-        if (discordEnabled) {
-            bool sent = false;
-            for (int retry = 0; retry < maxRetries && !sent; ++retry) {
-                if (retry > 0) {
-                    Logger::get().info() << "[Discord] Retry " << retry << "/"
-                                         << maxRetries << endl;
-                    exponentialBackoff(retry - 1);
-                }
-                sent = sendFileToDiscord(filePath, fileSize);
-            }
-            if (sent)
-                anySuccess = true;
-            else
-                Logger::get().error() << "[Discord] Upload failed after "
-                                      << maxRetries << " attempts" << endl;
-        }
+    if (queueAdd(entry.filePath, entry.fileSize, entry.pending, 0, 0)) {
+        LOG_INFO() << "Resumed: " << entry.filePath << endl;
+    } else {
+        LOG_WARN() << "Queue full, leaving in journal: " << entry.filePath
+                   << endl;
+    }
+    return true;
+}
 
-        if (!anySuccess) {
-            Logger::get().error() << "All uploads failed" << endl;
-        }
+void initLogger(bool truncate) {
+    if (truncate) {
+        Logger::get().truncate();
     }
+
+    applyLogLevel();
+
+    constexpr std::string_view separator = "=============================";
+    auto logger = Logger::get().none();
+    logger << separator << endl;
+    logger << APP_TITLE " v" << APP_VERSION << " is starting..." << endl;
+    logger << separator << endl;
 }
 
 int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
@@ -256,15 +230,20 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
     // so that config errors are properly logged
     initLogger(true);
 
-    if (!Config::get().refresh()) {
-        Logger::get().error()
+    bool configValid;
+    {
+        MemoryScope scope(MemorySubsystem::Config);
+        configValid = Config::load();
+    }
+    if (!configValid) {
+        LOG_ERROR()
             << "Configuration validation failed: No valid upload channel "
                "available (Telegram, Ntfy and Discord are disabled or "
                "misconfigured)."
             << endl;
-        Logger::get().error() << "Please check your config.ini file and ensure "
-                                 "at least one channel is properly configured."
-                              << endl;
+        LOG_ERROR() << "Please check your config.ini file and ensure at "
+                       "least one channel is properly configured."
+                    << endl;
         Logger::get().close();
         return 0;
     }
@@ -281,39 +260,47 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
 
     Result rc = capsaGetAutoSavingStorage(&storage);
     if (!R_SUCCEEDED(rc)) {
-        Logger::get().error() << "capsaGetAutoSavingStorage() failed: " << rc
-                              << ", exiting..." << endl;
+        LOG_ERROR() << "capsaGetAutoSavingStorage() failed: " << rc
+                    << ", exiting..." << endl;
         return 0;
     }
 
     rc = fsOpenImageDirectoryFileSystem(
         &imageFs, static_cast<FsImageDirectoryId>(storage));
     if (!R_SUCCEEDED(rc)) {
-        Logger::get().error()
-            << "fsOpenImageDirectoryFileSystem() failed: " << rc
-            << ", exiting..." << endl;
+        LOG_ERROR() << "fsOpenImageDirectoryFileSystem() failed: " << rc
+                    << ", exiting..." << endl;
         return 0;
     }
 
     const int mountRes = fsdevMountDevice("img", imageFs);
     if (mountRes < 0) {
-        Logger::get().error()
-            << "fsdevMountDevice() failed, exiting..." << endl;
+        LOG_ERROR() << "fsdevMountDevice() failed, exiting..." << endl;
         return 0;
     }
 
-    Logger::get().info() << "Mounted " << (storage ? "SD" : "NAND")
-                         << " storage" << endl;
+    LOG_INFO() << "Mounted " << (storage ? "SD" : "NAND") << " storage" << endl;
+    albumInit(storage);
 
-    // Get the initial last file (for comparison)
-    // If album is not ready (Err), we'll use the first valid item later
-    auto lastItemResult = getLastAlbumItem();
+    // Initialize queue and resume work left unfinished before a reboot
+    queueInit();
+    dedupInit();
+    std::string highWaterMark;
+    journalReplay(resumeJournalEntry, highWaterMark);
+
+    // Get the initial last file (for comparison). Continue from the journal
+    // high-water mark so captures taken while the module was not running are
+    // picked up. If album is not ready (Err), we'll use the first valid item
+    // later
+    std::expected<std::string, std::string> lastItemResult = highWaterMark;
+    if (highWaterMark.empty()) {
+        MemoryScope scope(MemorySubsystem::Album);
+        lastItemResult = getLastAlbumItem();
+    }
     if (lastItemResult.has_value()) {
-        Logger::get().info()
-            << "Current last item: " << lastItemResult.value() << endl;
+        LOG_INFO() << "Current last item: " << lastItemResult.value() << endl;
     } else {
-        Logger::get().info()
-            << "Album not ready: " << lastItemResult.error() << endl;
+        LOG_INFO() << "Album not ready: " << lastItemResult.error() << endl;
     }
 
     // Log enabled upload channels
@@ -332,67 +319,111 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
         logger << endl;
     }
 
-    // Determine Telegram upload mode based on configuration
-    const std::string_view telegramUploadMode =
-        Config::get().getTelegramUploadMode();
+    // Log Telegram upload mode based on configuration
     if (Config::get().telegramEnabled()) {
-        Logger::get().info()
-            << "Telegram upload mode: " << telegramUploadMode << endl;
+        LOG_INFO() << "Telegram upload mode: "
+                   << Config::get().getTelegramUploadMode() << endl;
     }
 
-    // Get check interval configuration
-    const int checkInterval = Config::get().getCheckIntervalSeconds();
-    const u64 sleepDuration =
-        static_cast<u64>(checkInterval) * 1'000'000'000ULL;
-    Logger::get().info() << "Check interval: " << checkInterval << " second(s)"
-                         << endl;
+    // Baseline before the worker starts allocating curl handles
+    memoryLog("Startup");
 
-    // Initialize queue
-    queueInit();
+    // Get check interval configuration
+    PollScheduler scheduler;
+    applyDetectionMode(scheduler);
+
+    // Start the upload worker; the loop below only detects new items so
+    // pickup latency does not depend on transfers
+    uint32_t configGeneration = Config::generation();
+    if (!uploadWorkerStart()) {
+        LOG_ERROR() << "Failed to start upload worker thread, exiting..."
+                    << endl;
+        return 0;
+    }
 
-    // Main detection loop (runs forever for sysmodule)
+    // Main detection loop (runs forever for sysmodule). Every pass gets an
+    // id so the worker can batch screenshots found together; 0 is reserved
+    // for items resumed from the journal.
+    uint32_t pollId = 0;
     while (true) {
+        // Parse config.ini if it changed; the worker activates it between
+        // uploads, after which the new interval and log level apply here
+        bool configChanged;
+        {
+            MemoryScope scope(MemorySubsystem::Config);
+            configChanged = Config::reloadIfChanged();
+        }
+        if (configChanged) {
+            queueNotify();
+        }
+        if (configGeneration != Config::generation()) {
+            configGeneration = Config::generation();
+            applyLogLevel();
+            applyDetectionMode(scheduler);
+        }
+        const ChannelMask enabledChannels = uploadEnabledChannels();
+        const u64 detectTick = armGetSystemTick();
+
         // Get the last known item path for comparison
         std::string_view lastItemPath =
             lastItemResult.has_value() ? lastItemResult.value() : "";
 
-        auto newItemsResult = getNewAlbumItems(lastItemPath);
+        static AlbumItem newItems[MAX_NEW_ALBUM_ITEMS];
+        std::expected<size_t, std::string> newItemsResult;
+        {
+            MemoryScope scope(MemorySubsystem::Album);
+            newItemsResult =
+                getNewAlbumItems(lastItemPath, newItems, MAX_NEW_ALBUM_ITEMS);
+        }
 
         // Skip if error (album not ready)
         if (!newItemsResult.has_value()) {
-            svcSleepThread(sleepDuration);
+            waitForNextCheck(scheduler,
+                             scheduler.next(false, isApplicationRunning()));
             continue;
         }
 
-        const auto& newItems = newItemsResult.value();
+        const size_t newCount = newItemsResult.value();
+        if (newCount > 0 && ++pollId == 0) {
+            pollId = 1;
+        }
 
         // Process all new items
-        for (const auto& item : newItems) {
+        for (size_t i = 0; i < newCount; ++i) {
+            char item[ALBUM_PATH_MAX];
+            newItems[i].path(item);
             const size_t fs = filesize(item);
 
             if (fs > 0) {
-                if (queueAdd(item.c_str(), fs)) {
-                    Logger::get().info()
-                        << "New: " << item << " (queue: " << queueCount() << ")"
-                        << endl;
+                // Journal before queueing so the worker can never complete
+                // an item the journal has not seen yet
+                journalEnqueue(item, fs, enabledChannels);
+                if (queueAdd(item, fs, enabledChannels, pollId, detectTick)) {
+                    LOG_INFO() << "New: " << item << " (queue: " << queueCount()
+                               << ")" << endl;
 
                     // Update lastItemResult only after successful queue
                     // addition
-                    lastItemResult = item;
+                    lastItemResult = std::string(item);
+
+                    // Only now, or a video left for the next poll would
+                    // send its preview again every time
+                    if (Config::get().videoPreview() && isVideoFile(item)) {
+                        queuePreview(item, enabledChannels, pollId,
+                                     detectTick);
+                    }
                 } else {
-                    Logger::get().error()
-                        << "Queue full, skipping: " << item << endl;
+                    LOG_ERROR() << "Queue full, skipping: " << item << endl;
                     // Do not update lastItemResult - we'll retry this item on
                     // next iteration
                 }
             }
         }
 
-        // Process the upload queue immediately after detecting new items
-        if (queueCount() > 0) {
-            processUploadQueue();
-        }
-
-        svcSleepThread(sleepDuration);
+        // Check again soon after a capture or while a title runs, back off
+        // when idle
+        const bool found = newCount > 0;
+        waitForNextCheck(scheduler,
+                         scheduler.next(found, isApplicationRunning()));
     }
 }
@@ -0,0 +1,211 @@
+#include "memory.hpp"
+
+#include <malloc.h>
+#include <reent.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include "logger.hpp"
+
+extern "C" {
+// Bounds of the heap set up by __libnx_initheap()
+extern char* fake_heap_start;
+extern char* fake_heap_end;
+
+// Recursive lock newlib takes around every allocator call
+void __malloc_lock(_reent* r);
+void __malloc_unlock(_reent* r);
+}
+
+namespace {
+// Resolution of the largest free block probe
+constexpr size_t PROBE_GRANULARITY = 256;
+
+thread_local MemorySubsystem t_subsystem = MemorySubsystem::Other;
+
+// Sampled by memorySnapshot(), and by every allocation with
+// ENABLE_HEAP_STATS
+std::atomic<size_t> g_peakInUse{0};
+
+void raisePeak(size_t inUse) noexcept {
+    size_t peak = g_peakInUse.load(std::memory_order_relaxed);
+    while (inUse > peak && !g_peakInUse.compare_exchange_weak(
+                               peak, inUse, std::memory_order_relaxed)) {
+    }
+}
+
+size_t heapSize() noexcept {
+    return static_cast<size_t>(fake_heap_end - fake_heap_start);
+}
+}  // namespace
+
+#ifdef ENABLE_HEAP_STATS
+// The newlib allocator entry points are wrapped with -Wl,--wrap (see
+// src/CMakeLists.txt), so every malloc/free in the binary, including curl,
+// mbedTLS and libstdc++, passes through here
+extern "C" {
+void* __real__malloc_r(_reent* r, size_t size);
+void* __real__calloc_r(_reent* r, size_t count, size_t size);
+void* __real__realloc_r(_reent* r, void* ptr, size_t size);
+void* __real__memalign_r(_reent* r, size_t alignment, size_t size);
+void __real__free_r(_reent* r, void* ptr);
+}
+
+namespace {
+constexpr std::string_view SUBSYSTEM_NAMES[MEMORY_SUBSYSTEM_COUNT] = {
+    "other", "album", "transfer", "config"};
+
+std::atomic<size_t> g_inUse{0};
+std::atomic<uint32_t> g_allocations[MEMORY_SUBSYSTEM_COUNT];
+std::atomic<uint64_t> g_allocatedBytes[MEMORY_SUBSYSTEM_COUNT];
+std::atomic<uint32_t> g_failedAllocations{0};
+
+void* recordAllocation(_reent* r, void* ptr) noexcept {
+    if (!ptr) {
+        g_failedAllocations.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    const size_t size = _malloc_usable_size_r(r, ptr);
+    const auto subsystem = static_cast<size_t>(t_subsystem);
+    g_allocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes[subsystem].fetch_add(size, std::memory_order_relaxed);
+    raisePeak(g_inUse.fetch_add(size, std::memory_order_relaxed) + size);
+    return ptr;
+}
+
+void recordFree(_reent* r, void* ptr) noexcept {
+    if (ptr) {
+        g_inUse.fetch_sub(_malloc_usable_size_r(r, ptr),
+                          std::memory_order_relaxed);
+    }
+}
+
+void* rawMalloc(size_t size) noexcept {
+    return __real__malloc_r(_REENT, size);
+}
+void rawFree(void* ptr) noexcept { __real__free_r(_REENT, ptr); }
+}  // namespace
+
+extern "C" {
+void* __wrap__malloc_r(_reent* r, size_t size) {
+    return recordAllocation(r, __real__malloc_r(r, size));
+}
+
+void* __wrap__calloc_r(_reent* r, size_t count, size_t size) {
+    return recordAllocation(r, __real__calloc_r(r, count, size));
+}
+
+void* __wrap__memalign_r(_reent* r, size_t alignment, size_t size) {
+    return recordAllocation(r, __real__memalign_r(r, alignment, size));
+}
+
+void* __wrap__realloc_r(_reent* r, void* ptr, size_t size) {
+    const size_t oldSize = ptr ? _malloc_usable_size_r(r, ptr) : 0;
+    void* result = __real__realloc_r(r, ptr, size);
+    if (!result) {
+        // realloc(ptr, 0) frees; otherwise the old block is untouched
+        if (size == 0) {
+            g_inUse.fetch_sub(oldSize, std::memory_order_relaxed);
+        } else {
+            g_failedAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        return nullptr;
+    }
+
+    g_inUse.fetch_sub(oldSize, std::memory_order_relaxed);
+    return recordAllocation(r, result);
+}
+
+void __wrap__free_r(_reent* r, void* ptr) {
+    recordFree(r, ptr);
+    __real__free_r(r, ptr);
+}
+}
+#else
+namespace {
+void* rawMalloc(size_t size) noexcept { return std::malloc(size); }
+void rawFree(void* ptr) noexcept { std::free(ptr); }
+}  // namespace
+#endif
+
+namespace {
+// Largest block malloc can hand out right now, found by bisecting with
+// real allocations (about 20 malloc/free pairs, never charged to anyone).
+// The allocator lock is held throughout so the other thread waits instead
+// of failing while a probe holds most of the heap.
+size_t probeLargestFree(size_t upperBound) noexcept {
+    __malloc_lock(_REENT);
+    size_t low = 0;
+    size_t high = upperBound + 1;
+    while (high - low > PROBE_GRANULARITY) {
+        const size_t mid = low + (high - low) / 2;
+        if (void* block = rawMalloc(mid)) {
+            rawFree(block);
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    __malloc_unlock(_REENT);
+    return low;
+}
+}  // namespace
+
+MemoryScope::MemoryScope(MemorySubsystem subsystem) noexcept
+    : m_previous(t_subsystem) {
+    t_subsystem = subsystem;
+}
+
+MemoryScope::~MemoryScope() { t_subsystem = m_previous; }
+
+MemorySnapshot memorySnapshot() {
+    MemorySnapshot snapshot{};
+    const struct mallinfo info = mallinfo();
+
+    // mallinfo() only covers what newlib has taken from the heap so far
+    snapshot.heapSize = heapSize();
+    snapshot.inUse = info.uordblks;
+    const size_t untouched =
+        snapshot.heapSize - std::min<size_t>(info.arena, snapshot.heapSize);
+    snapshot.free = info.fordblks + untouched;
+
+    raisePeak(snapshot.inUse);
+    snapshot.peakInUse = g_peakInUse.load(std::memory_order_relaxed);
+    snapshot.largestFree = probeLargestFree(snapshot.free);
+
+#ifdef ENABLE_HEAP_STATS
+    for (size_t i = 0; i < MEMORY_SUBSYSTEM_COUNT; ++i) {
+        snapshot.allocations[i] =
+            g_allocations[i].load(std::memory_order_relaxed);
+        snapshot.allocatedBytes[i] =
+            g_allocatedBytes[i].load(std::memory_order_relaxed);
+    }
+    snapshot.failedAllocations =
+        g_failedAllocations.load(std::memory_order_relaxed);
+#endif
+
+    return snapshot;
+}
+
+void memoryLog(std::string_view context, bool failure) {
+    // Take the snapshot before the log line holds the logger lock
+    const MemorySnapshot s = memorySnapshot();
+
+    LogMessage message = failure ? Logger::get().warn() : Logger::get().info();
+    message << "[Memory] " << context << ": used " << s.inUse / 1024
+            << "KB, peak " << s.peakInUse / 1024 << "KB, free "
+            << s.free / 1024 << "KB, largest " << s.largestFree / 1024
+            << "KB of " << s.heapSize / 1024 << "KB";
+#ifdef ENABLE_HEAP_STATS
+    message << " | allocs";
+    for (size_t i = 0; i < MEMORY_SUBSYSTEM_COUNT; ++i) {
+        message << " " << SUBSYSTEM_NAMES[i] << "=" << s.allocations[i] << "/"
+                << s.allocatedBytes[i] / 1024 << "KB";
+    }
+    message << " failed=" << s.failedAllocations;
+#endif
+    message << endl;
+}
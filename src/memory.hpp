@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Accounting for the newlib heap (INNER_HEAP_SIZE in main.cpp) that curl,
+// mbedTLS, the config parser and the rest of the sysmodule share. Current
+// and free bytes come from mallinfo(). With ENABLE_HEAP_STATS the newlib
+// allocator is wrapped at link time, which makes the peak exact and counts
+// allocations per subsystem; without it the peak is sampled whenever a
+// snapshot is taken.
+
+// Part of the sysmodule an allocation is charged to
+enum class MemorySubsystem : uint8_t {
+    Other = 0,     // Anything outside a MemoryScope
+    Album = 1,     // Album discovery
+    Transfer = 2,  // curl/TLS transfers run by the upload worker
+    Config = 3,    // config.ini parsing
+};
+
+constexpr size_t MEMORY_SUBSYSTEM_COUNT = 4;
+
+// Charge allocations of the calling thread to `subsystem` while in scope
+class MemoryScope {
+   public:
+    explicit MemoryScope(MemorySubsystem subsystem) noexcept;
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+   private:
+    MemorySubsystem m_previous;
+};
+
+struct MemorySnapshot {
+    size_t heapSize;     // Bytes handed to newlib
+    size_t inUse;        // Allocated bytes
+    size_t peakInUse;    // Highest inUse seen
+    size_t free;         // Free chunks plus the never-used end of the heap
+    size_t largestFree;  // Largest single allocation that would succeed
+    // Per subsystem, only filled with ENABLE_HEAP_STATS
+    uint32_t allocations[MEMORY_SUBSYSTEM_COUNT];
+    uint64_t allocatedBytes[MEMORY_SUBSYSTEM_COUNT];
+    uint32_t failedAllocations;
+};
+
+[[nodiscard]] MemorySnapshot memorySnapshot();
+
+// Log a one-line heap summary; `failure` logs it as a warning
+void memoryLog(std::string_view context, bool failure = false);
@@ -0,0 +1,81 @@
+#include "network.hpp"
+
+#include <curl/curl.h>
+#include <switch.h>
+
+#include "logger.hpp"
+#include "upload.hpp"
+
+namespace {
+// The socket transfer memory is SB_EFFICIENCY times the page-rounded sum of
+// the max buffer sizes, allocated from the heap. The receive ceiling is the
+// stock one (TLS handshakes and HTTP responses arrive through it); the send
+// ceiling takes what is left of the same 96KB.
+constexpr size_t TCP_TX_BUF_SIZE = 0x800;
+constexpr size_t TCP_RX_BUF_SIZE = 0x1000;
+constexpr size_t TCP_TX_BUF_SIZE_MAX = SOCKET_SEND_BUFFER_MAX;
+constexpr size_t TCP_RX_BUF_SIZE_MAX = 0x2EE0;
+constexpr size_t UDP_TX_BUF_SIZE = 0;
+constexpr size_t UDP_RX_BUF_SIZE = 0;
+constexpr size_t SB_EFFICIENCY = 4;
+constexpr size_t SOCKET_MEMORY_BUDGET = 0x18000;  // 96KB
+static_assert((TCP_TX_BUF_SIZE_MAX + TCP_RX_BUF_SIZE_MAX + 0xFFF) / 0x1000 *
+                      0x1000 * SB_EFFICIENCY <=
+                  SOCKET_MEMORY_BUDGET,
+              "socket transfer memory over budget");
+
+bool g_up = false;
+}  // namespace
+
+bool networkUp() {
+    if (g_up) return true;
+
+    constexpr SocketInitConfig socket_config = {
+        .tcp_tx_buf_size = TCP_TX_BUF_SIZE,
+        .tcp_rx_buf_size = TCP_RX_BUF_SIZE,
+        .tcp_tx_buf_max_size = TCP_TX_BUF_SIZE_MAX,
+        .tcp_rx_buf_max_size = TCP_RX_BUF_SIZE_MAX,
+
+        .udp_tx_buf_size = UDP_TX_BUF_SIZE,
+        .udp_rx_buf_size = UDP_RX_BUF_SIZE,
+
+        .sb_efficiency = SB_EFFICIENCY,
+    };
+
+    Result rc = socketInitialize(&socket_config);
+    if (R_FAILED(rc)) {
+        LOG_ERROR() << "[Network] socketInitialize() failed: " << rc << endl;
+        return false;
+    }
+
+    const CURLcode res = curl_global_init(CURL_GLOBAL_DEFAULT);
+    if (res != CURLE_OK) {
+        LOG_ERROR() << "[Network] curl_global_init() failed: "
+                    << curl_easy_strerror(res) << endl;
+        socketExit();
+        return false;
+    }
+
+    if (!uploadInit()) {
+        LOG_WARN() << "[Network] curl_share_init() failed, uploads will not "
+                      "share caches"
+                   << endl;
+    }
+
+    g_up = true;
+    LOG_DEBUG() << "[Network] Up" << endl;
+    return true;
+}
+
+void networkDown() {
+    if (!g_up) return;
+
+    uploadCleanup();
+    curl_global_cleanup();
+    socketExit();
+
+    g_up = false;
+    LOG_DEBUG() << "[Network] Down" << endl;
+}
+
+bool networkIsUp() noexcept { return g_up; }
@@ -0,0 +1,16 @@
+#pragma once
+
+// Sockets and curl, brought up by the upload worker. With lazy_network they
+// only run while there is something to upload and go down again after
+// network_idle_timeout, which returns the socket transfer memory and the curl
+// and TLS state to the heap. Only used by the upload worker thread (and by
+// __appExit).
+
+// Initialize sockets, curl and the shared curl caches. Does nothing if the
+// network is already up.
+[[nodiscard]] bool networkUp();
+
+// Tear down everything networkUp() started. Does nothing if it is down.
+void networkDown();
+
+[[nodiscard]] bool networkIsUp() noexcept;
@@ -0,0 +1,100 @@
+#include "preview.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "album.hpp"
+#include "config.hpp"
+#include "journal.hpp"
+#include "logger.hpp"
+#include "project.h"
+
+namespace {
+constexpr const char* PREVIEW_DIR = "sdmc:/config/" APP_TITLE "/previews";
+
+// Previews deleted per previewCreate() call at most
+constexpr size_t MAX_PRUNED_PREVIEWS = 8;
+
+// Delete previews the journal no longer waits for: left behind when the app
+// stopped between an upload finishing and its preview being deleted.
+// Pending ones stay, however many recordings are still waiting.
+void prunePreviews() {
+    DIR* dir = opendir(PREVIEW_DIR);
+    if (!dir) return;
+
+    // Collected first, so nothing is removed while the directory is read
+    char stale[MAX_PRUNED_PREVIEWS][PREVIEW_PATH_MAX];
+    size_t count = 0;
+    while (count < MAX_PRUNED_PREVIEWS) {
+        const dirent* entry = readdir(dir);
+        if (!entry) break;
+
+        const std::string_view name = entry->d_name;
+        if (!name.ends_with(".jpg")) continue;
+        const int length =
+            std::snprintf(stale[count], PREVIEW_PATH_MAX, "%s/%.*s",
+                          PREVIEW_DIR, static_cast<int>(name.size()),
+                          name.data());
+        if (length < 0 || static_cast<size_t>(length) >= PREVIEW_PATH_MAX) {
+            continue;
+        }
+        if (!journalIsPending(stale[count])) ++count;
+    }
+    closedir(dir);
+
+    for (size_t i = 0; i < count; ++i) {
+        std::remove(stale[i]);
+    }
+}
+}  // namespace
+
+ChannelMask previewChannels(ChannelMask channels) {
+    const Config& config = Config::get();
+    ChannelMask movies = 0;
+    if (config.telegramUploadMovies())
+        movies |= channelBit(UploadChannel::Telegram);
+    if (config.ntfyUploadMovies()) movies |= channelBit(UploadChannel::Ntfy);
+    if (config.discordUploadMovies())
+        movies |= channelBit(UploadChannel::Discord);
+    return channels & movies;
+}
+
+bool previewCreate(std::string_view moviePath,
+                   char (&previewPath)[PREVIEW_PATH_MAX]) {
+    // "<key>-<title id>.mp4" becomes "<key>-<title id>.jpg", so uploads
+    // find the title id where they expect it
+    const size_t slash = moviePath.rfind('/');
+    std::string_view name =
+        slash == std::string_view::npos ? moviePath
+                                        : moviePath.substr(slash + 1);
+    if (!name.ends_with(".mp4")) return false;
+    name.remove_suffix(4);
+
+    const int length =
+        std::snprintf(previewPath, PREVIEW_PATH_MAX, "%s/%.*s.jpg", PREVIEW_DIR,
+                      static_cast<int>(name.size()), name.data());
+    if (length < 0 || static_cast<size_t>(length) >= PREVIEW_PATH_MAX) {
+        return false;
+    }
+
+    mkdir(PREVIEW_DIR, 0700);
+    prunePreviews();
+    return albumSaveMovieThumbnail(moviePath, previewPath);
+}
+
+void previewDelete(std::string_view filePath) {
+    const std::string_view dir = PREVIEW_DIR;
+    if (filePath.size() <= dir.size() || !filePath.starts_with(dir) ||
+        filePath[dir.size()] != '/') {
+        return;
+    }
+
+    const std::string path{filePath};
+    if (std::remove(path.c_str()) == 0) {
+        LOG_DEBUG() << "[Preview] Deleted " << path << endl;
+    }
+}
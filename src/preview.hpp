@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "upload.hpp"
+
+// Previews of new recordings: the album thumbnail of a video is queued as a
+// screenshot ahead of the video itself, so a notification arrives within
+// seconds while the full upload takes its turn in the video lane. Previews
+// are written to sdmc:/config/<app>/previews and deleted once every channel
+// is done with them.
+
+constexpr size_t PREVIEW_PATH_MAX = 128;
+
+// Channels of the mask that would receive the recording itself
+[[nodiscard]] ChannelMask previewChannels(ChannelMask channels);
+
+// Save the preview of a recording and write its path. Returns false if
+// the album has no thumbnail for it (see albumSaveMovieThumbnail).
+[[nodiscard]] bool previewCreate(std::string_view moviePath,
+                                 char (&previewPath)[PREVIEW_PATH_MAX]);
+
+// Delete the file if it is a preview; called by the upload worker once no
+// channel is left for it
+void previewDelete(std::string_view filePath);
@@ -2,59 +2,251 @@
 
 #include <switch.h>
 
+#include <cstdio>
 #include <cstring>
 
+#include "logger.hpp"
+#include "project.h"
+
 namespace {
-UploadTask g_uploadQueue[MAX_QUEUE_SIZE];
-size_t g_queueHead = 0;  // Read position
-size_t g_queueTail = 0;  // Write position
-size_t g_queueCount = 0;
+// Tasks that do not fit in a lane's RAM ring go to a per-lane spill file on
+// SD and are paged back in, in order, as the ring drains. The file is a ring
+// of MAX_SPILLED_TASKS records too, so a backlog that never drains cannot
+// grow it, and it stays open while it holds tasks. The spill files only live
+// for one session; the journal is what survives a reboot.
+
+template <size_t N>
+struct Lane {
+    UploadTask tasks[N];
+    size_t head = 0;  // Read position
+    size_t tail = 0;  // Write position
+    size_t count = 0;  // Tasks in the RAM ring
+
+    const char* spillPath;
+    FILE* spillFile = nullptr;  // Open while it holds tasks
+    size_t spilled = 0;         // Tasks waiting in the spill file
+    size_t spillHead = 0;       // Record to page in next
+
+    explicit Lane(const char* path) : spillPath(path) {}
+
+    [[nodiscard]] size_t total() const { return count + spilled; }
+
+    [[nodiscard]] bool push(const char* filePath, size_t fileSize,
+                            ChannelMask channels, uint32_t pollId,
+                            uint64_t detectTick) {
+        UploadTask task{};
+        std::strncpy(task.filePath, filePath, 127);
+        task.filePath[127] = '\0';
+        task.fileSize = fileSize;
+        task.channels = channels;
+        task.detectTick = detectTick;
+        task.enqueueTick = armGetSystemTick();
+        task.pollId = pollId;
+        task.valid = true;
+
+        // Once anything is spilled, newer tasks queue up behind it on SD
+        if (spilled > 0 || count >= N) {
+            return spill(task);
+        }
+
+        tasks[tail] = task;
+        tail = (tail + 1) % N;
+        count++;
+        return true;
+    }
+
+    // Returns the number of spilled tasks lost to an SD read error
+    size_t pop(UploadTask& task) {
+        task = tasks[head];
+        head = (head + 1) % N;
+        count--;
+        return pageIn();
+    }
+
+    [[nodiscard]] const UploadTask& front() const { return tasks[head]; }
+
+    [[nodiscard]] uint64_t oldestAgeNs() const {
+        return armTicksToNs(armGetSystemTick() - front().enqueueTick);
+    }
+
+    // Start the session without spill files from a previous run
+    void clearSpill() {
+        closeSpill();
+        std::remove(spillPath);
+        spilled = 0;
+    }
+
+   private:
+    [[nodiscard]] bool spill(const UploadTask& task) {
+        if (spilled >= MAX_SPILLED_TASKS) return false;
+
+        if (!spillFile) {
+            // A file left from an earlier overflow is reused; its records
+            // are overwritten before they are read
+            spillFile = std::fopen(spillPath, "r+b");
+            if (!spillFile) spillFile = std::fopen(spillPath, "w+b");
+            if (!spillFile) return false;
+        }
+
+        const size_t record = (spillHead + spilled) % MAX_SPILLED_TASKS;
+        if (!seekRecord(record) ||
+            std::fwrite(&task, sizeof(task), 1, spillFile) != 1) {
+            return false;
+        }
+        spilled++;
+        return true;
+    }
+
+    // Refill the RAM ring from the spill file
+    size_t pageIn() {
+        if (spilled == 0 || count >= N) return 0;
+
+        while (spilled > 0 && count < N && spillFile &&
+               seekRecord(spillHead) &&
+               std::fread(&tasks[tail], sizeof(UploadTask), 1, spillFile) ==
+                   1) {
+            tail = (tail + 1) % N;
+            count++;
+            spilled--;
+            spillHead = (spillHead + 1) % MAX_SPILLED_TASKS;
+        }
+
+        // Whatever could not be read back is gone for this session
+        size_t lost = 0;
+        if (spilled > 0 && count < N) {
+            lost = spilled;
+            spilled = 0;
+        }
+        if (spilled == 0) {
+            closeSpill();
+        }
+        return lost;
+    }
+
+    [[nodiscard]] bool seekRecord(size_t record) {
+        return std::fseek(spillFile,
+                          static_cast<long>(record * sizeof(UploadTask)),
+                          SEEK_SET) == 0;
+    }
+
+    // The file is kept for the next overflow; its records are stale now
+    void closeSpill() {
+        if (spillFile) {
+            std::fclose(spillFile);
+            spillFile = nullptr;
+        }
+        spillHead = 0;
+    }
+};
+
+Lane<IMAGE_QUEUE_SIZE> g_imageLane("sdmc:/config/" APP_TITLE
+                                    "/queue_images.bin");
+Lane<VIDEO_QUEUE_SIZE> g_videoLane("sdmc:/config/" APP_TITLE
+                                   "/queue_videos.bin");
 
 Mutex g_queueMutex;
+CondVar g_queueCondVar;  // Signaled when a task is added
+bool g_queueNotified = false;  // queueNotify() called since the last wait
+
+size_t totalCount() { return g_imageLane.total() + g_videoLane.total(); }
+
+// Tasks the worker may take right now
+size_t availableCount(bool includeVideos) {
+    return includeVideos ? totalCount() : g_imageLane.total();
+}
 }  // namespace
 
-void queueInit() { mutexInit(&g_queueMutex); }
+void queueInit() {
+    mutexInit(&g_queueMutex);
+    condvarInit(&g_queueCondVar);
+    g_imageLane.clearSpill();
+    g_videoLane.clearSpill();
+}
+
+bool queueAdd(const char* filePath, size_t fileSize, ChannelMask channels,
+              uint32_t pollId, uint64_t detectTick) {
+    mutexLock(&g_queueMutex);
+
+    const bool added =
+        isVideoFile(filePath)
+            ? g_videoLane.push(filePath, fileSize, channels, pollId, detectTick)
+            : g_imageLane.push(filePath, fileSize, channels, pollId,
+                               detectTick);
+    if (added) {
+        condvarWakeOne(&g_queueCondVar);
+    }
 
-bool queueAdd(const char* filePath, size_t fileSize) {
+    mutexUnlock(&g_queueMutex);
+    return added;
+}
+
+size_t queueGetBatch(UploadTask* tasks, size_t maxTasks, bool includeVideos) {
     mutexLock(&g_queueMutex);
 
-    if (g_queueCount >= MAX_QUEUE_SIZE) {
+    if (availableCount(includeVideos) == 0 || maxTasks == 0) {
         mutexUnlock(&g_queueMutex);
-        return false;
+        return 0;
     }
 
-    std::strncpy(g_uploadQueue[g_queueTail].filePath, filePath, 127);
-    g_uploadQueue[g_queueTail].filePath[127] = '\0';
-    g_uploadQueue[g_queueTail].fileSize = fileSize;
-    g_queueTail = (g_queueTail + 1) % MAX_QUEUE_SIZE;
-    g_queueCount++;
+    // Images first, unless the oldest video has aged past its limit
+    const bool takeVideo =
+        includeVideos && g_videoLane.count > 0 &&
+        (g_imageLane.count == 0 || g_videoLane.oldestAgeNs() >= VIDEO_AGING_NS);
+
+    size_t count = 0;
+    size_t lost = 0;
+    if (takeVideo) {
+        lost += g_videoLane.pop(tasks[count++]);
+    } else {
+        lost += g_imageLane.pop(tasks[count++]);
+        while (count < maxTasks && g_imageLane.count > 0 &&
+               g_imageLane.front().pollId == tasks[0].pollId &&
+               g_imageLane.front().channels == tasks[0].channels) {
+            lost += g_imageLane.pop(tasks[count++]);
+        }
+    }
 
     mutexUnlock(&g_queueMutex);
-    return true;
+
+    // Logged outside the queue lock (log lines may call queueCount())
+    if (lost > 0) {
+        LOG_ERROR() << "[Queue] Could not read back " << lost
+                    << " spilled task(s); they stay in the journal" << endl;
+    }
+    return count;
 }
 
-bool queueGet(char* filePath, size_t filePath_size, size_t& fileSize) {
+bool queueWait(uint64_t timeoutNs, bool includeVideos) {
     mutexLock(&g_queueMutex);
 
-    if (g_queueCount == 0) {
-        mutexUnlock(&g_queueMutex);
-        return false;
+    if (availableCount(includeVideos) == 0 && !g_queueNotified) {
+        condvarWaitTimeout(&g_queueCondVar, &g_queueMutex, timeoutNs);
     }
+    g_queueNotified = false;
+    const bool available = availableCount(includeVideos) > 0;
 
-    std::strncpy(filePath, g_uploadQueue[g_queueHead].filePath,
-                 filePath_size - 1);
-    filePath[filePath_size - 1] = '\0';
-    fileSize = g_uploadQueue[g_queueHead].fileSize;
-    g_queueHead = (g_queueHead + 1) % MAX_QUEUE_SIZE;
-    g_queueCount--;
+    mutexUnlock(&g_queueMutex);
+    return available;
+}
 
+void queueNotify() {
+    mutexLock(&g_queueMutex);
+    g_queueNotified = true;
+    condvarWakeOne(&g_queueCondVar);
     mutexUnlock(&g_queueMutex);
-    return true;
 }
 
 size_t queueCount() {
     mutexLock(&g_queueMutex);
-    size_t count = g_queueCount;
+    size_t count = totalCount();
+    mutexUnlock(&g_queueMutex);
+    return count;
+}
+
+size_t queueLaneCount(QueueLane lane) {
+    mutexLock(&g_queueMutex);
+    size_t count =
+        lane == QueueLane::Video ? g_videoLane.total() : g_imageLane.total();
     mutexUnlock(&g_queueMutex);
     return count;
 }
@@ -3,26 +3,67 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "upload.hpp"
+
 // Upload task with fixed-size buffer (no heap allocation)
 struct UploadTask {
     char filePath[128];  // Fixed buffer for path
     size_t fileSize;
+    ChannelMask channels;  // Channels still to deliver to
+    uint64_t detectTick;   // Start of the album check that found it (0 if
+                           // resumed from the journal)
+    uint64_t enqueueTick;  // armGetSystemTick() when queued
+    uint32_t pollId;       // Detection pass that found the file
     bool valid;
 };
 
-constexpr size_t MAX_QUEUE_SIZE = 8;
+// Screenshots and videos wait in separate lanes so a large video cannot hold
+// up the screenshots taken after it. Images are served first; a video that
+// has waited VIDEO_AGING_NS goes ahead of them so it cannot starve. Each lane
+// has its own RAM depth, so a burst of videos never fills the image lane;
+// tasks beyond it overflow to a spill file on SD and are paged back in as
+// the lane drains.
+enum class QueueLane : uint8_t {
+    Image = 0,
+    Video = 1,
+};
+
+constexpr size_t IMAGE_QUEUE_SIZE = 8;
+constexpr size_t VIDEO_QUEUE_SIZE = 4;
+constexpr size_t MAX_QUEUE_SIZE = IMAGE_QUEUE_SIZE + VIDEO_QUEUE_SIZE;
+constexpr size_t MAX_SPILLED_TASKS = 1024;  // Per lane, 168KB on SD
+// Tasks both lanes hold with their spill files full
+constexpr size_t MAX_QUEUED_TASKS = MAX_QUEUE_SIZE + 2 * MAX_SPILLED_TASKS;
+constexpr uint64_t VIDEO_AGING_NS = 60'000'000'000ULL;  // 60s
 
 // Initialize the upload queue and mutex
 void queueInit();
 
-// Add a task to the queue
-// Returns true if successfully added, false if queue is full
-[[nodiscard]] bool queueAdd(const char* filePath, size_t fileSize);
+// Add a task to the lane matching its file type. Screenshots sharing a
+// `pollId` can be taken together as one batch.
+// Returns true if successfully added, false if that lane and its spill file
+// are full
+[[nodiscard]] bool queueAdd(const char* filePath, size_t fileSize,
+                            ChannelMask channels, uint32_t pollId,
+                            uint64_t detectTick);
 
-// Try to get the next task from the queue
-// Returns true if a task was retrieved, false if queue is empty
-[[nodiscard]] bool queueGet(char* filePath, size_t filePath_size,
-                            size_t& fileSize);
+// Take the next task by lane priority, followed by up to `maxTasks - 1`
+// screenshots queued right behind it from the same poll with the same
+// channels. With `includeVideos` false the video lane is left alone.
+// Returns the number of tasks written to `tasks` (0 if empty).
+[[nodiscard]] size_t queueGetBatch(UploadTask* tasks, size_t maxTasks,
+                                   bool includeVideos);
+
+// Block until the queue holds at least one task (a screenshot, unless
+// `includeVideos`) or the timeout expires
+// Returns true if a task is available
+[[nodiscard]] bool queueWait(uint64_t timeoutNs, bool includeVideos);
+
+// Wake a thread blocked in queueWait() without adding a task
+void queueNotify();
 
 // Get the current number of items in the queue
 [[nodiscard]] size_t queueCount();
+
+// Get the current number of items in one lane
+[[nodiscard]] size_t queueLaneCount(QueueLane lane);
@@ -0,0 +1,95 @@
+#include "retry.hpp"
+
+#include <switch.h>
+
+#include <cstring>
+
+namespace {
+struct RetryEntry {
+    char filePath[128];
+    size_t fileSize;
+    u64 dueTick;
+    UploadChannel channel;
+    uint8_t attempts;
+    bool valid;
+};
+
+RetryEntry g_retries[MAX_RETRY_ENTRIES];
+
+// Index of the entry that is due first, or MAX_RETRY_ENTRIES if empty
+size_t findEarliest() {
+    size_t earliest = MAX_RETRY_ENTRIES;
+    for (size_t i = 0; i < MAX_RETRY_ENTRIES; ++i) {
+        if (!g_retries[i].valid) continue;
+        if (earliest == MAX_RETRY_ENTRIES ||
+            g_retries[i].dueTick < g_retries[earliest].dueTick) {
+            earliest = i;
+        }
+    }
+    return earliest;
+}
+}  // namespace
+
+bool retrySchedule(const char* filePath, size_t fileSize,
+                   UploadChannel channel, int attempts) {
+    return retryDefer(filePath, fileSize, channel, attempts,
+                      retryBackoffNs(attempts));
+}
+
+bool retryDefer(const char* filePath, size_t fileSize, UploadChannel channel,
+                int attempts, uint64_t delayNs) {
+    for (auto& entry : g_retries) {
+        if (entry.valid) continue;
+
+        std::strncpy(entry.filePath, filePath, sizeof(entry.filePath) - 1);
+        entry.filePath[sizeof(entry.filePath) - 1] = '\0';
+        entry.fileSize = fileSize;
+        entry.dueTick = armGetSystemTick() + armNsToTicks(delayNs);
+        entry.channel = channel;
+        entry.attempts = static_cast<uint8_t>(attempts);
+        entry.valid = true;
+        return true;
+    }
+    return false;
+}
+
+bool retryHasRoom() {
+    for (const auto& entry : g_retries) {
+        if (!entry.valid) return true;
+    }
+    return false;
+}
+
+bool retryTakeDue(RetryBatch& batch) {
+    const size_t earliest = findEarliest();
+    if (earliest == MAX_RETRY_ENTRIES) return false;
+
+    const u64 now = armGetSystemTick();
+    if (g_retries[earliest].dueTick > now) return false;
+
+    std::memcpy(batch.filePath, g_retries[earliest].filePath,
+                sizeof(batch.filePath));
+    batch.fileSize = g_retries[earliest].fileSize;
+    batch.channels = 0;
+    std::memset(batch.attempts, 0, sizeof(batch.attempts));
+
+    // Fold every due channel of the same file into one attempt
+    for (auto& entry : g_retries) {
+        if (!entry.valid || entry.dueTick > now) continue;
+        if (std::strcmp(entry.filePath, batch.filePath) != 0) continue;
+
+        batch.channels |= channelBit(entry.channel);
+        batch.attempts[static_cast<size_t>(entry.channel)] = entry.attempts;
+        entry.valid = false;
+    }
+    return true;
+}
+
+uint64_t retryNextDueNs() {
+    const size_t earliest = findEarliest();
+    if (earliest == MAX_RETRY_ENTRIES) return UINT64_MAX;
+
+    const u64 now = armGetSystemTick();
+    const u64 due = g_retries[earliest].dueTick;
+    return due > now ? armTicksToNs(due - now) : 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "queue.hpp"
+#include "upload.hpp"
+
+// Timed retry queue for failed (file, channel) pairs. A failed pair waits
+// out its backoff here while other channels and newer items keep flowing.
+// Only used by the upload worker thread.
+
+constexpr size_t MAX_RETRY_ENTRIES = MAX_QUEUE_SIZE * UPLOAD_CHANNEL_COUNT;
+
+// All due channels of one file, collected for a single fan-out attempt
+struct RetryBatch {
+    char filePath[128];
+    size_t fileSize;
+    ChannelMask channels;
+    uint8_t attempts[UPLOAD_CHANNEL_COUNT];  // Failed attempts per channel
+};
+
+// Backoff before the next attempt (1s, 2s, 4s...) after `attempts` failures
+[[nodiscard]] constexpr uint64_t retryBackoffNs(int attempts) noexcept {
+    return (1ULL << (attempts - 1)) * 1'000'000'000ULL;
+}
+
+// Schedule another attempt for a (file, channel) pair that has failed
+// `attempts` times. Returns false if the retry queue is full.
+[[nodiscard]] bool retrySchedule(const char* filePath, size_t fileSize,
+                                 UploadChannel channel, int attempts);
+
+// Park a (file, channel) pair for delayNs without counting an attempt, e.g.
+// while its channel is paused. Returns false if the retry queue is full.
+[[nodiscard]] bool retryDefer(const char* filePath, size_t fileSize,
+                              UploadChannel channel, int attempts,
+                              uint64_t delayNs);
+
+// True if another pair can be scheduled
+[[nodiscard]] bool retryHasRoom();
+
+// Take every due entry of the file whose retry is due first
+// Returns true if a batch was filled
+[[nodiscard]] bool retryTakeDue(RetryBatch& batch);
+
+// Nanoseconds until the next retry is due (0 if one is due now,
+// UINT64_MAX if nothing is scheduled)
+[[nodiscard]] uint64_t retryNextDueNs();
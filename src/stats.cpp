@@ -0,0 +1,164 @@
+#include "stats.hpp"
+
+#include <switch.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+#include "config.hpp"
+#include "logger.hpp"
+#include "project.h"
+
+namespace {
+constexpr const char* STATS_PATH = "sdmc:/config/" APP_TITLE "/stats.txt";
+
+constexpr const char* STAGE_NAMES[STATS_STAGE_COUNT] = {
+    "detect", "queue", "dns", "connect", "tls", "first_byte", "transfer"};
+
+struct StageHistogram {
+    uint32_t buckets[STATS_BUCKET_COUNT];
+    uint32_t count;
+    uint32_t maxMs;
+    uint64_t totalMs;
+
+    void add(uint64_t us) {
+        const uint64_t ms = us / 1000;
+        const size_t bucket =
+            std::min<size_t>(std::bit_width(ms), STATS_BUCKET_COUNT - 1);
+        ++buckets[bucket];
+        ++count;
+        totalMs += ms;
+        maxMs = std::max<uint32_t>(maxMs, static_cast<uint32_t>(ms));
+
+        if (count >= STATS_ROLLING_SAMPLES) {
+            for (uint32_t& b : buckets) b /= 2;
+            count /= 2;
+            totalMs /= 2;
+        }
+    }
+};
+
+struct ChannelStats {
+    StageHistogram stages[STATS_STAGE_COUNT];  // Network stages only
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t retries;
+    uint64_t bytesSent;
+};
+
+struct Stats {
+    StageHistogram detect;
+    StageHistogram queueWait;
+    ChannelStats channels[UPLOAD_CHANNEL_COUNT];
+};
+
+Stats g_stats;
+bool g_dirty = false;
+u64 g_lastDumpTick = 0;
+
+void addStage(StageHistogram& histogram, int64_t fromUs, int64_t toUs) {
+    if (toUs > fromUs) histogram.add(static_cast<uint64_t>(toUs - fromUs));
+}
+
+void writeHistogram(FILE* f, const char* name, const StageHistogram& h) {
+    if (h.count == 0) return;
+
+    std::fprintf(f, "  %-10s n=%lu avg=%lums max=%lums |", name,
+                 static_cast<unsigned long>(h.count),
+                 static_cast<unsigned long>(h.totalMs / h.count),
+                 static_cast<unsigned long>(h.maxMs));
+    for (const uint32_t b : h.buckets) {
+        std::fprintf(f, " %lu", static_cast<unsigned long>(b));
+    }
+    std::fputc('\n', f);
+}
+}  // namespace
+
+void statsRecordDequeue(uint64_t detectTick, uint64_t enqueueTick) {
+    if (detectTick != 0 && enqueueTick >= detectTick) {
+        g_stats.detect.add(armTicksToNs(enqueueTick - detectTick) / 1000);
+    }
+    g_stats.queueWait.add(armTicksToNs(armGetSystemTick() - enqueueTick) /
+                          1000);
+    g_dirty = true;
+}
+
+void statsRecordTransfer(UploadChannel channel, const TransferTimings& timings,
+                         uint64_t bytesSent, bool success) {
+    ChannelStats& c = g_stats.channels[static_cast<size_t>(channel)];
+    ++c.requests;
+    if (!success) ++c.failures;
+    c.bytesSent += bytesSent;
+
+    // Curl reports cumulative times; stages that did not happen (reused
+    // connection, failed request) stay out of their histogram
+    auto stage = [&](StatsStage s) -> StageHistogram& {
+        return c.stages[static_cast<size_t>(s)];
+    };
+    addStage(stage(StatsStage::Dns), 0, timings.nameLookupUs);
+    addStage(stage(StatsStage::Connect), timings.nameLookupUs,
+             timings.connectUs);
+    if (timings.appConnectUs > 0) {
+        addStage(stage(StatsStage::Tls), timings.connectUs,
+                 timings.appConnectUs);
+    }
+    if (timings.startTransferUs > 0) {
+        addStage(stage(StatsStage::FirstByte), timings.preTransferUs,
+                 timings.startTransferUs);
+    }
+    if (success) {
+        addStage(stage(StatsStage::Transfer), timings.preTransferUs,
+                 timings.totalUs);
+    }
+    g_dirty = true;
+}
+
+void statsRecordRetry(UploadChannel channel) {
+    ++g_stats.channels[static_cast<size_t>(channel)].retries;
+    g_dirty = true;
+}
+
+void statsDumpIfDue() {
+    if (!g_dirty || !Config::get().writeStats()) return;
+
+    const u64 now = armGetSystemTick();
+    if (g_lastDumpTick != 0 &&
+        armTicksToNs(now - g_lastDumpTick) < STATS_DUMP_INTERVAL_NS) {
+        return;
+    }
+    g_lastDumpTick = now;
+
+    FILE* f = std::fopen(STATS_PATH, "w");
+    if (!f) {
+        LOG_WARN() << "[Stats] Could not open " << STATS_PATH << endl;
+        return;
+    }
+
+    std::fprintf(f, "# " APP_TITLE " upload stats, histogram buckets: <1ms "
+                    "then powers of two ms\n");
+    std::fprintf(f, "pipeline\n");
+    writeHistogram(f, STAGE_NAMES[static_cast<size_t>(StatsStage::Detect)],
+                   g_stats.detect);
+    writeHistogram(f, STAGE_NAMES[static_cast<size_t>(StatsStage::QueueWait)],
+                   g_stats.queueWait);
+
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        const ChannelStats& c = g_stats.channels[i];
+        if (c.requests == 0) continue;
+
+        std::fprintf(f, "%s requests=%lu failures=%lu retries=%lu bytes=%llu\n",
+                     channelName(static_cast<UploadChannel>(i)).data(),
+                     static_cast<unsigned long>(c.requests),
+                     static_cast<unsigned long>(c.failures),
+                     static_cast<unsigned long>(c.retries),
+                     static_cast<unsigned long long>(c.bytesSent));
+        for (size_t s = static_cast<size_t>(StatsStage::Dns);
+             s < STATS_STAGE_COUNT; ++s) {
+            writeHistogram(f, STAGE_NAMES[s], c.stages[s]);
+        }
+    }
+
+    std::fclose(f);
+    g_dirty = false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "upload.hpp"
+
+// Upload pipeline timings. Every stage keeps a latency histogram: detection
+// and queue wait per file, the network stages per channel. All counters live
+// in one fixed-size record that is written to STATS_PATH as text every
+// STATS_DUMP_INTERVAL_NS while something changed. Only used by the upload
+// worker thread.
+
+// Time spent between two points of an upload
+enum class StatsStage : uint8_t {
+    Detect = 0,     // Album check started -> queued
+    QueueWait = 1,  // Queued -> taken by the worker
+    Dns = 2,        // Name lookup
+    Connect = 3,    // TCP connect
+    Tls = 4,        // TLS handshake (0 on a reused connection)
+    FirstByte = 5,  // Request start -> first response byte (includes body)
+    Transfer = 6,   // Request start -> response complete
+};
+
+constexpr size_t STATS_STAGE_COUNT = 7;
+
+// Log2 millisecond buckets: <1ms, 1ms, 2-3ms, 4-7ms ... >=16.4s
+constexpr size_t STATS_BUCKET_COUNT = 16;
+
+// Histograms are halved once they hold this many samples, so they follow
+// recent behaviour instead of the whole uptime
+constexpr uint32_t STATS_ROLLING_SAMPLES = 256;
+
+constexpr uint64_t STATS_DUMP_INTERVAL_NS = 60'000'000'000ULL;  // 1 min
+
+// Curl timings of one finished request, in microseconds since its start
+// (CURLINFO_*_TIME_T)
+struct TransferTimings {
+    int64_t nameLookupUs;
+    int64_t connectUs;
+    int64_t appConnectUs;
+    int64_t preTransferUs;
+    int64_t startTransferUs;
+    int64_t totalUs;
+};
+
+// Record detection and queue latency of a file taken by the worker.
+// A zero `detectTick` (resumed from the journal) skips the detect stage.
+void statsRecordDequeue(uint64_t detectTick, uint64_t enqueueTick);
+
+// Record one request to a channel
+void statsRecordTransfer(UploadChannel channel, const TransferTimings& timings,
+                         uint64_t bytesSent, bool success);
+
+// Record a retry scheduled for a channel
+void statsRecordRetry(UploadChannel channel);
+
+// Write the stats file if enabled, something changed and the interval passed
+void statsDumpIfDue();
@@ -0,0 +1,140 @@
+#include "transcode.hpp"
+
+#include <cstdio>
+
+#include "logger.hpp"
+
+#ifdef ENABLE_TRANSCODE
+#include <jpeglib.h>
+
+#include <csetjmp>
+
+namespace {
+// libjpeg reports fatal errors through error_exit, which must not return;
+// jump back into transcodeJpeg() instead
+struct ErrorManager {
+    jpeg_error_mgr base;
+    jmp_buf escape;
+};
+
+[[noreturn]] void onError(j_common_ptr cinfo) {
+    auto* errors = reinterpret_cast<ErrorManager*>(cinfo->err);
+    char message[JMSG_LENGTH_MAX];
+    errors->base.format_message(cinfo, message);
+    LOG_WARN() << "[Transcode] " << message << endl;
+    std::longjmp(errors->escape, 1);
+}
+
+// Warnings (corrupt data that could be recovered) only matter when debugging
+void onMessage(j_common_ptr cinfo) {
+    char message[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, message);
+    LOG_DEBUG() << "[Transcode] " << message << endl;
+}
+
+// Largest scale in eighths that keeps the image within maxWidth
+unsigned int scaleEighths(JDIMENSION width, int maxWidth) noexcept {
+    unsigned int eighths = 8;
+    while (eighths > 1 &&
+           (width * eighths + 7) / 8 > static_cast<JDIMENSION>(maxWidth)) {
+        --eighths;
+    }
+    return eighths;
+}
+
+// Everything libjpeg touches lives here, so nothing with a destructor is
+// skipped when an error longjmps out of the codec
+struct Codec {
+    ErrorManager errors{};
+    jpeg_decompress_struct decoder{};
+    jpeg_compress_struct encoder{};
+    FILE* in{nullptr};
+    FILE* out{nullptr};
+};
+
+// Returns false if libjpeg raised an error
+bool run(Codec& c, const TranscodeSettings& settings) {
+    if (setjmp(c.errors.escape)) return false;
+
+    // Creating the codecs allocates, so it may already fail
+    jpeg_create_decompress(&c.decoder);
+    jpeg_create_compress(&c.encoder);
+
+    jpeg_stdio_src(&c.decoder, c.in);
+    jpeg_read_header(&c.decoder, TRUE);
+
+    // Stay in YCbCr (or grayscale) end to end to skip two color conversions
+    const bool gray = c.decoder.num_components == 1;
+    c.decoder.out_color_space = gray ? JCS_GRAYSCALE : JCS_YCbCr;
+    c.decoder.scale_num = scaleEighths(c.decoder.image_width,
+                                       settings.maxWidth);
+    c.decoder.scale_denom = 8;
+    c.decoder.dct_method = JDCT_IFAST;
+    c.decoder.do_fancy_upsampling = FALSE;
+    jpeg_start_decompress(&c.decoder);
+
+    jpeg_stdio_dest(&c.encoder, c.out);
+    c.encoder.image_width = c.decoder.output_width;
+    c.encoder.image_height = c.decoder.output_height;
+    c.encoder.input_components = c.decoder.output_components;
+    c.encoder.in_color_space = c.decoder.out_color_space;
+    jpeg_set_defaults(&c.encoder);
+    jpeg_set_quality(&c.encoder, settings.quality, TRUE);
+    c.encoder.dct_method = JDCT_IFAST;
+    jpeg_start_compress(&c.encoder, TRUE);
+
+    // One row in the decoder's pool, released with it
+    const JDIMENSION rowBytes =
+        c.decoder.output_width *
+        static_cast<JDIMENSION>(c.decoder.output_components);
+    JSAMPARRAY row = (*c.decoder.mem->alloc_sarray)(
+        reinterpret_cast<j_common_ptr>(&c.decoder), JPOOL_IMAGE, rowBytes, 1);
+    while (c.decoder.output_scanline < c.decoder.output_height) {
+        jpeg_read_scanlines(&c.decoder, row, 1);
+        jpeg_write_scanlines(&c.encoder, row, 1);
+    }
+
+    jpeg_finish_compress(&c.encoder);
+    jpeg_finish_decompress(&c.decoder);
+    return true;
+}
+}  // namespace
+
+bool transcodeJpeg(const char* srcPath, const char* dstPath,
+                   const TranscodeSettings& settings) {
+    Codec c;
+    c.in = std::fopen(srcPath, "rb");
+    if (!c.in) {
+        LOG_WARN() << "[Transcode] Failed to open " << srcPath << endl;
+        return false;
+    }
+    c.out = std::fopen(dstPath, "wb");
+    if (!c.out) {
+        LOG_WARN() << "[Transcode] Failed to create " << dstPath << endl;
+        std::fclose(c.in);
+        return false;
+    }
+
+    c.decoder.err = jpeg_std_error(&c.errors.base);
+    c.errors.base.error_exit = onError;
+    c.errors.base.output_message = onMessage;
+    c.encoder.err = &c.errors.base;
+
+    // Destroying a codec that was never created does nothing
+    bool ok = run(c, settings);
+
+    jpeg_destroy_compress(&c.encoder);
+    jpeg_destroy_decompress(&c.decoder);
+    std::fclose(c.in);
+    ok &= std::fclose(c.out) == 0;
+    if (!ok) std::remove(dstPath);
+    return ok;
+}
+#else
+bool transcodeJpeg(const char* srcPath, [[maybe_unused]] const char* dstPath,
+                   [[maybe_unused]] const TranscodeSettings& settings) {
+    LOG_WARN() << "[Transcode] Built without ENABLE_TRANSCODE, sending "
+               << srcPath << " as is" << endl;
+    return false;
+}
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+// Re-encoding of screenshots at a lower quality and resolution before they
+// are uploaded, so slow links carry a fraction of the original JPEG.
+// Scanlines are streamed from the decoder straight into the encoder, which
+// keeps memory at the codec state plus one row whatever the image size.
+
+struct TranscodeSettings {
+    int quality;   // JPEG quality 1-100; 0 sends the original
+    int maxWidth;  // Scaled down in 1/8 steps until no wider than this
+
+    [[nodiscard]] constexpr bool enabled() const noexcept {
+        return quality > 0;
+    }
+    constexpr bool operator==(const TranscodeSettings&) const = default;
+};
+
+// Re-encode the JPEG at `srcPath` into `dstPath`. Returns false if it could
+// not be decoded, encoded or written (e.g. out of heap); the caller then
+// sends the original.
+[[nodiscard]] bool transcodeJpeg(const char* srcPath, const char* dstPath,
+                                 const TranscodeSettings& settings);
@@ -1,51 +1,584 @@
 #include "upload.hpp"
 
 #include <curl/curl.h>
-
+#include <switch.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <memory>
+#include <new>
+#include <string>
 #include <string_view>
 
+#include "activity.hpp"
 #include "config.hpp"
+#include "health.hpp"
 #include "logger.hpp"
+#include "project.h"
+#include "stats.hpp"
+#include "transcode.hpp"
+#include "utils.hpp"
 
 namespace fs = std::filesystem;
 
 namespace {
 
-constexpr size_t NX_CURL_BUFFERSIZE = 0x2000L;         // 8KB
-constexpr size_t NX_CURL_UPLOAD_BUFFERSIZE = 0x2000L;  // 8KB
+// Buffer sizes of one upload, picked per file type from the
+// image/video_transfer_profile settings. The curl buffers are heap allocated
+// per transfer, the two read windows once per file. The send buffer comes out
+// of the socket transfer memory set up by networkUp() and is applied when a
+// connection is opened.
+struct TransferProfileSettings {
+    long sendBuffer;     // SO_SNDBUF, at most SOCKET_SEND_BUFFER_MAX
+    long uploadBuffer;   // CURLOPT_UPLOAD_BUFFERSIZE (curl minimum 16KB)
+    long receiveBuffer;  // CURLOPT_BUFFERSIZE
+    size_t readWindow;   // SharedReader window
+};
+
+// Heap per transfer: 24KB, 40KB and 72KB (+32KB/64KB/64KB read windows)
+constexpr TransferProfileSettings SMALL_PROFILE = {0x2000, 0x4000, 0x2000,
+                                                   0x4000};
+constexpr TransferProfileSettings MEDIUM_PROFILE = {SOCKET_SEND_BUFFER_MAX,
+                                                    0x8000, 0x2000, 0x8000};
+constexpr TransferProfileSettings LARGE_PROFILE = {SOCKET_SEND_BUFFER_MAX,
+                                                   0x10000, 0x2000, 0x8000};
+
+const TransferProfileSettings& transferProfile(bool isVideo) noexcept {
+    const std::string_view name = Config::get().getTransferProfile(isVideo);
+    if (name == TransferProfile::Large) return LARGE_PROFILE;
+    if (name == TransferProfile::Medium) return MEDIUM_PROFILE;
+    return SMALL_PROFILE;
+}
+
+// Send buffer of the connection last opened to each channel. Pooled
+// connections keep the buffer they were opened with.
+long g_connectionSendBuffer[UPLOAD_CHANNEL_COUNT] = {};
+
+// Long-lived CURL handles per channel. Telegram gets a second slot so
+// "both" upload mode does not tear down the compressed connection.
+// Handles are reset rather than recreated between uploads; the caches they
+// use live in the share object below.
+constexpr size_t HANDLES_PER_CHANNEL = 2;
+CURL* g_handles[UPLOAD_CHANNEL_COUNT][HANDLES_PER_CHANNEL] = {};
+
+// One share object behind every handle: DNS cache, TLS session cache and
+// connection pool, so a retry or another channel to the same host skips
+// name lookup and a full handshake. Created by uploadInit(); curl only runs
+// on the upload worker, but the lock callbacks keep that safe to change.
+CURLSH* g_share = nullptr;
+Mutex g_shareLocks[CURL_LOCK_DATA_LAST];
+// Handle slots whose last request failed on the connection. Their next
+// request resolves the host again and opens a connection of its own; the
+// other channels keep what the share holds for them. The share itself is
+// only rebuilt when the network goes down.
+bool g_connectionFailed[UPLOAD_CHANNEL_COUNT][HANDLES_PER_CHANNEL] = {};
+
+// Shared lookups outlive curl's 60s default so the addresses resolved by
+// uploadPrewarm() are still there for the first capture
+constexpr long DNS_CACHE_TIMEOUT_SECONDS = 1800;  // 30 min
+
+void lockShare(CURL*, curl_lock_data data, curl_lock_access, void*) noexcept {
+    mutexLock(&g_shareLocks[data]);
+}
+
+void unlockShare(CURL*, curl_lock_data data, void*) noexcept {
+    mutexUnlock(&g_shareLocks[data]);
+}
+
+CURLSH* createShare() noexcept {
+    CURLSH* share = curl_share_init();
+    if (!share) return nullptr;
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    return share;
+}
+
+// Detach every pooled handle from the share and free it
+void destroyShare() noexcept {
+    if (!g_share) return;
+
+    for (auto& channelHandles : g_handles) {
+        for (CURL* handle : channelHandles) {
+            if (handle) curl_easy_setopt(handle, CURLOPT_SHARE, nullptr);
+        }
+    }
+    const CURLSHcode rc = curl_share_cleanup(g_share);
+    if (rc != CURLSHE_OK) {
+        LOG_WARN() << "[Upload] curl_share_cleanup() failed: "
+                   << curl_share_strerror(rc) << endl;
+    }
+    g_share = nullptr;
+}
+
+// Get a warm handle for the channel, creating it on first use
+CURL* acquireHandle(UploadChannel channel, size_t slot = 0) noexcept {
+    CURL*& handle = g_handles[static_cast<size_t>(channel)][slot];
+    if (handle) {
+        curl_easy_reset(handle);
+    } else {
+        handle = curl_easy_init();
+        if (!handle) return nullptr;
+    }
+
+    if (g_share) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, g_share);
+        curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT,
+                         DNS_CACHE_TIMEOUT_SECONDS);
+    }
+
+    // Retry after a connection error: no cached address, pooled connection
+    // or TLS session of the one that failed
+    bool& failed = g_connectionFailed[static_cast<size_t>(channel)][slot];
+    if (failed) {
+        failed = false;
+        curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, 0L);
+        curl_easy_setopt(handle, CURLOPT_FRESH_CONNECT, 1L);
+        curl_easy_setopt(handle, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+    }
+
+    // Keep idle connections alive between captures
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, 15L);
+    return handle;
+}
+
+// Errors after which the cached connection/TLS state must not be reused
+constexpr bool isConnectionError(CURLcode res) noexcept {
+    switch (res) {
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_OPERATION_TIMEDOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Return the handle to the pool. After a connection error its next request
+// starts over (see acquireHandle()).
+void releaseHandle(UploadChannel channel, size_t slot, CURLcode res) noexcept {
+    if (isConnectionError(res)) {
+        g_connectionFailed[static_cast<size_t>(channel)][slot] = true;
+    }
+}
+
+// Shared read windows. Each reader holds two (one being sent, one being
+// prefetched) of the transfer profile's window size while it streams.
+// Reads are window-sized at window-aligned offsets into page-aligned
+// buffers, which lets fs map them instead of copying through small chunks.
+constexpr size_t READ_BUFFER_ALIGNMENT = 0x1000;
+// How often a running upload re-evaluates upload_pacing
+constexpr uint64_t PACING_RECHECK_NS = 2'000'000'000ULL;
+
+constexpr size_t MAX_TRANSFERS = 4;  // Telegram x2 (both mode), ntfy, Discord
+
+// Persistent multi handle driving all channel transfers concurrently. Easy
+// handles added to it share its connection pool.
+CURLM* g_multi = nullptr;
 
+class SharedReader;
+
+// Per-transfer read state: every transfer keeps its own offset into the file
 struct UploadInfo {
-    FILE* f;
-    size_t sizeLeft;
+    SharedReader* reader;
+    size_t offset;
+    size_t lastLoggedOffset;
+    bool active;  // Still consuming data (false once the transfer finished)
+    bool paused;  // Returned CURL_READFUNC_PAUSE, waiting for the window
+};
+
+// Page-aligned heap buffer for fs reads
+struct AlignedBufferDeleter {
+    void operator()(char* p) const noexcept {
+        ::operator delete[](p, std::align_val_t{READ_BUFFER_ALIGNMENT});
+    }
+};
+using AlignedBuffer = std::unique_ptr<char[], AlignedBufferDeleter>;
+
+AlignedBuffer makeAlignedBuffer(size_t size) {
+    return AlignedBuffer(static_cast<char*>(::operator new[](
+        size, std::align_val_t{READ_BUFFER_ALIGNMENT}, std::nothrow)));
+}
+
+// File contents shared by every transfer of one upload. The file is read
+// from storage once into a sliding window; a transfer that runs ahead of the
+// slowest one pauses until the window can move on. Reads go straight to
+// fsFileRead on the device's filesystem (bypassing stdio), and while the
+// transfers send one window the next is prefetched into a second buffer.
+// A reader can also cover just `size` bytes from `base`, one part of a split
+// video; offsets are then relative to `base`.
+class SharedReader {
+   public:
+    SharedReader(const char* path, size_t size, size_t base = 0) noexcept {
+        reset(path, size, base);
+    }
+
+    SharedReader() noexcept : SharedReader(nullptr, 0) {}
+
+    ~SharedReader() { release(); }
+
+    SharedReader(const SharedReader&) = delete;
+    SharedReader& operator=(const SharedReader&) = delete;
+
+    [[nodiscard]] const char* path() const noexcept { return m_path; }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+    void addConsumer(UploadInfo& info) noexcept {
+        info = UploadInfo{this, 0, 0, true, false};
+        if (m_consumerCount < MAX_TRANSFERS) {
+            m_consumers[m_consumerCount++] = &info;
+        }
+    }
+
+    // Copy the next bytes for a consumer. Returns CURL_READFUNC_PAUSE if the
+    // consumer has to wait for slower ones, CURL_READFUNC_ABORT on I/O error.
+    size_t read(UploadInfo& info, char* dst, size_t maxBytes) noexcept {
+        if (info.offset >= m_windowEnd) {
+            if (!canAdvance()) {
+                info.paused = true;
+                return CURL_READFUNC_PAUSE;
+            }
+            if (!advance()) {
+                return CURL_READFUNC_ABORT;
+            }
+        }
+
+        const size_t bytes = std::min(maxBytes, m_windowEnd - info.offset);
+        std::memcpy(dst,
+                    m_buffers[m_front].get() + (info.offset - m_windowStart),
+                    bytes);
+        info.offset += bytes;
+
+        // Give the buffers back as soon as nobody needs the file any more, so
+        // a batch only holds the windows of the files currently streaming
+        if (m_windowEnd == m_size && allConsumed()) {
+            release();
+        }
+        return bytes;
+    }
+
+    // True if a paused consumer can make progress again
+    [[nodiscard]] bool canResume(const UploadInfo& info) const noexcept {
+        return info.offset < m_windowEnd || canAdvance();
+    }
+
+    // Load the next window into the idle buffer ahead of time. Called from
+    // the transfer loop while curl is waiting on the network; a failure is
+    // retried (and reported) when the window is actually needed.
+    void prefetch() noexcept {
+        if (m_open && m_backLength == 0 && m_windowEnd < m_size) {
+            [[maybe_unused]] const bool loaded = loadBack();
+        }
+    }
+
+    // Move a consumer to `offset` when curl rewinds the body. A window that
+    // no longer holds it is dropped and the file is read again from the
+    // start; consumers further ahead wait until it catches up.
+    void seek(UploadInfo& info, size_t offset) noexcept {
+        info.offset = offset;
+        info.lastLoggedOffset = offset;
+        if (offset < m_windowStart || !m_open) {
+            m_windowStart = 0;
+            m_windowEnd = 0;
+            m_backLength = 0;
+        }
+    }
+
+    // Window size of the next open, as picked by applyTransferProfile()
+    void setWindowSize(size_t size) noexcept {
+        if (!m_open) m_windowSize = size;
+    }
+
+    // Point a reader at a file, dropping anything it was reading before
+    void reset(const char* path, size_t size, size_t base = 0) noexcept {
+        release();
+        m_path = path;
+        m_size = size;
+        m_base = base;
+        m_windowSize =
+            transferProfile(path && isVideoFile(path)).readWindow;
+        m_windowStart = 0;
+        m_windowEnd = 0;
+        m_consumerCount = 0;
+    }
+
+   private:
+    // The window may only move once every active consumer has consumed it
+    [[nodiscard]] bool canAdvance() const noexcept {
+        for (size_t i = 0; i < m_consumerCount; ++i) {
+            const UploadInfo* c = m_consumers[i];
+            if (c->active && c->offset < m_windowEnd) return false;
+        }
+        return m_windowEnd < m_size;
+    }
+
+    [[nodiscard]] bool allConsumed() const noexcept {
+        for (size_t i = 0; i < m_consumerCount; ++i) {
+            const UploadInfo* c = m_consumers[i];
+            if (c->active && c->offset < m_size) return false;
+        }
+        return true;
+    }
+
+    // Open the file on the filesystem of its fsdev device ("img:/..." or
+    // "sdmc:/...") and allocate both windows
+    bool open() noexcept {
+        const char* separator = std::strchr(m_path, ':');
+        FsFileSystem* fs =
+            separator ? fsdevGetDeviceFileSystem(m_path) : nullptr;
+        if (!fs) {
+            LOG_ERROR() << "[Upload] No filesystem for file: " << m_path
+                        << endl;
+            return false;
+        }
+
+        const Result rc =
+            fsFsOpenFile(fs, separator + 1, FsOpenMode_Read, &m_file);
+        if (R_FAILED(rc)) {
+            LOG_ERROR() << "[Upload] fsFsOpenFile() failed: " << rc
+                        << " for file: " << m_path << endl;
+            return false;
+        }
+        m_open = true;
+
+        for (AlignedBuffer& buffer : m_buffers) {
+            buffer = makeAlignedBuffer(m_windowSize);
+            if (!buffer) {
+                LOG_ERROR() << "[Upload] Out of memory for read window" << endl;
+                release();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Read the window following the current one into the idle buffer
+    bool loadBack() noexcept {
+        const size_t toRead = std::min(m_windowSize, m_size - m_windowEnd);
+        u64 bytesRead = 0;
+        const Result rc =
+            fsFileRead(&m_file, static_cast<s64>(m_base + m_windowEnd),
+                       m_buffers[m_front ^ 1].get(), toRead,
+                       FsReadOption_None, &bytesRead);
+        if (R_FAILED(rc) || bytesRead == 0) {
+            LOG_ERROR() << "[Upload] Read failed at offset "
+                        << m_base + m_windowEnd
+                        << " for file: " << m_path << " (" << rc << ")"
+                        << endl;
+            return false;
+        }
+
+        m_backLength = bytesRead;
+        return true;
+    }
+
+    // Make the prefetched window current, reading it now if needed
+    bool advance() noexcept {
+        if (!m_open && !open()) return false;
+        if (m_backLength == 0 && !loadBack()) return false;
+
+        m_front ^= 1;
+        m_windowStart = m_windowEnd;
+        m_windowEnd += m_backLength;
+        m_backLength = 0;
+        return true;
+    }
+
+    void release() noexcept {
+        if (m_open) {
+            fsFileClose(&m_file);
+            m_open = false;
+        }
+        for (AlignedBuffer& buffer : m_buffers) {
+            buffer.reset();
+        }
+        m_backLength = 0;
+    }
+
+    const char* m_path{nullptr};
+    size_t m_size{0};
+    size_t m_base{0};  // File offset of the first byte
+    size_t m_windowSize{SMALL_PROFILE.readWindow};
+    FsFile m_file{};
+    bool m_open{false};
+    AlignedBuffer m_buffers[2];
+    size_t m_front{0};       // Buffer holding [m_windowStart, m_windowEnd)
+    size_t m_backLength{0};  // Bytes prefetched into the other buffer
+    size_t m_windowStart{0};
+    size_t m_windowEnd{0};
+    UploadInfo* m_consumers[MAX_TRANSFERS]{};
+    size_t m_consumerCount{0};
+};
+
+// Re-encode settings of a channel's screenshots
+TranscodeSettings transcodeSettings(UploadChannel channel) noexcept {
+    switch (channel) {
+        case UploadChannel::Telegram:
+            return Config::get().getTelegramTranscode();
+        case UploadChannel::Ntfy:
+            return Config::get().getNtfyTranscode();
+        case UploadChannel::Discord:
+            return Config::get().getDiscordTranscode();
+    }
+    return {};
+}
+
+// Re-encoded copies of the screenshots of one upload (see transcode.hpp),
+// written to SD and streamed from there like the originals. Channels with
+// the same settings share a copy; videos and files that fail to re-encode
+// keep reading the original. Copies are made before any transfer starts, so
+// the codec is gone again before curl allocates its buffers.
+class TranscodedFiles {
+   public:
+    TranscodedFiles() = default;
+
+    ~TranscodedFiles() {
+        for (size_t s = 0; s < m_setCount; ++s) {
+            CopySet& set = m_sets[s];
+            for (size_t i = 0; i < MAX_BATCH_SIZE; ++i) {
+                if (!set.ready[i]) continue;
+                set.readers[i].reset(nullptr, 0);
+                std::remove(set.paths[i]);
+            }
+        }
+    }
+
+    TranscodedFiles(const TranscodedFiles&) = delete;
+    TranscodedFiles& operator=(const TranscodedFiles&) = delete;
+
+    // Point readers[0..count) at what a transfer of `channel` sends for
+    // each of `originals`
+    void select(UploadChannel channel, SharedReader* originals, size_t count,
+                SharedReader** readers) {
+        for (size_t i = 0; i < count; ++i) readers[i] = &originals[i];
+
+        const TranscodeSettings settings = transcodeSettings(channel);
+        if (!settings.enabled()) return;
+
+        CopySet* set = find(settings);
+        if (!set) set = create(settings, originals, count);
+        if (!set) return;
+        for (size_t i = 0; i < count; ++i) {
+            if (set->ready[i]) readers[i] = &set->readers[i];
+        }
+    }
+
+    // Reader a single-file transfer of `channel` sends
+    SharedReader& select(UploadChannel channel, SharedReader& original) {
+        SharedReader* reader;
+        select(channel, &original, 1, &reader);
+        return *reader;
+    }
+
+   private:
+    static constexpr size_t PATH_SIZE = 64;
+
+    struct CopySet {
+        TranscodeSettings settings{};
+        char paths[MAX_BATCH_SIZE][PATH_SIZE]{};
+        SharedReader readers[MAX_BATCH_SIZE];
+        bool ready[MAX_BATCH_SIZE]{};
+    };
+
+    CopySet* find(const TranscodeSettings& settings) noexcept {
+        for (size_t s = 0; s < m_setCount; ++s) {
+            if (m_sets[s].settings == settings) return &m_sets[s];
+        }
+        return nullptr;
+    }
+
+    CopySet* create(const TranscodeSettings& settings, SharedReader* originals,
+                    size_t count) {
+        if (m_setCount >= UPLOAD_CHANNEL_COUNT) return nullptr;
+
+        CopySet& set = m_sets[m_setCount];
+        set.settings = settings;
+        for (size_t i = 0; i < count; ++i) {
+            const char* path = originals[i].path();
+            if (!path || isVideoFile(path)) continue;
+
+            const int length = std::snprintf(
+                set.paths[i], PATH_SIZE,
+                "sdmc:/config/" APP_TITLE "/transcode_%zu_%zu.jpg",
+                m_setCount, i);
+            if (length < 0 || static_cast<size_t>(length) >= PATH_SIZE) {
+                continue;
+            }
+            if (!transcodeJpeg(path, set.paths[i], settings)) continue;
+
+            const size_t size = filesize(set.paths[i]);
+            if (size == 0) {
+                std::remove(set.paths[i]);
+                continue;
+            }
+            LOG_INFO() << "[Transcode] " << path << ": "
+                       << originals[i].size() << " -> " << size << " bytes"
+                       << endl;
+            set.readers[i].reset(set.paths[i], size);
+            set.ready[i] = true;
+        }
+        return &m_sets[m_setCount++];
+    }
+
+    CopySet m_sets[UPLOAD_CHANNEL_COUNT];
+    size_t m_setCount{0};
 };
 
-size_t uploadReadFunction(void* ptr, size_t size, size_t nmemb,
+size_t uploadReadFunction(char* ptr, size_t size, size_t nmemb,
                           void* data) noexcept {
     auto* ui = static_cast<UploadInfo*>(data);
     const size_t maxBytes = size * nmemb;
 
-    if (maxBytes < 1 || ui->sizeLeft == 0) {
+    if (maxBytes < 1 || ui->offset >= ui->reader->size()) {
         return 0;
     }
 
-    const size_t bytesToRead = std::min(ui->sizeLeft, maxBytes);
-    const size_t bytesRead = std::fread(ptr, 1, bytesToRead, ui->f);
-    ui->sizeLeft -= bytesRead;
+    const size_t bytesRead = ui->reader->read(*ui, ptr, maxBytes);
+    if (bytesRead == CURL_READFUNC_PAUSE || bytesRead == CURL_READFUNC_ABORT) {
+        return bytesRead;
+    }
 
-    // Log progress every 100KB or at completion
-    static size_t lastLoggedProgress = 0;
-    const size_t currentProgress = ui->sizeLeft;
-    if (currentProgress == 0 ||
-        (lastLoggedProgress - currentProgress) >= 102400) {
-        Logger::get().debug() << "[Upload] Progress: " << currentProgress
-                              << " bytes remaining" << endl;
-        lastLoggedProgress = currentProgress;
+    // Log progress every 100KB or at completion; the bookkeeping is compiled
+    // out along with the message when debug logs are not built in
+    if constexpr (isLogCompiled(LogLevel::DEBUG)) {
+        const size_t currentProgress = ui->reader->size() - ui->offset;
+        if (currentProgress == 0 ||
+            (ui->offset - ui->lastLoggedOffset) >= 102400) {
+            LOG_DEBUG() << "[Upload] Progress: " << currentProgress
+                        << " bytes remaining" << endl;
+            ui->lastLoggedOffset = ui->offset;
+        }
     }
 
     return bytesRead;
 }
 
+// Rewind a part for curl, which sends the body again after finding a pooled
+// connection dead, following a 307/308 redirect or retrying with auth
+int uploadSeekFunction(void* data, curl_off_t offset, int origin) noexcept {
+    auto* ui = static_cast<UploadInfo*>(data);
+    if (origin != SEEK_SET || offset < 0 ||
+        static_cast<size_t>(offset) > ui->reader->size()) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    ui->reader->seek(*ui, static_cast<size_t>(offset));
+    return CURL_SEEKFUNC_OK;
+}
+
 struct FileTypeInfo {
     std::string_view contentType;
     std::string_view copyName;
@@ -66,6 +599,32 @@ constexpr FileTypeInfo getFileTypeInfo(std::string_view extension,
     return FileTypeInfo{"", "", ""};
 }
 
+// Split videos go out as plain data: a part on its own does not play
+constexpr std::string_view PART_CONTENT_TYPE = "application/octet-stream";
+
+// Parts a video is split into at most, one bit of PartProgress each
+constexpr size_t MAX_VIDEO_PARTS = 64;
+// Part sizes are rounded to this so reads of a part stay window-aligned
+constexpr size_t VIDEO_PART_ALIGNMENT = 0x10000;
+
+// One part of a video split for a channel (see video_part_size)
+struct FilePart {
+    size_t index;  // From 0
+    size_t count;
+};
+
+// Name a part is sent as: "<capture>.mp4.001", ".002" and so on, which
+// sorts and joins back into the video
+std::string partName(std::string_view path, const FilePart& part) {
+    // Three digits sort as numbers for every part
+    static_assert(MAX_VIDEO_PARTS <= 999);
+    char suffix[sizeof(".18446744073709551615")];  // Any size_t
+    std::snprintf(suffix, sizeof(suffix), ".%03zu", part.index + 1);
+    std::string name = fs::path{path}.filename().string();
+    name += suffix;
+    return name;
+}
+
 // Validation result for file uploads
 enum class ValidationResult {
     Success,  // Valid and should upload
@@ -80,28 +639,28 @@ ValidationResult validateUploadFile(std::string_view path,
                                     bool uploadScreenshots, bool uploadMovies) {
     // Extract Title ID (32 chars from the last 36 chars of the path)
     if (path.length() < 36) {
-        Logger::get().error() << logPrefix << "Invalid path length" << endl;
+        LOG_ERROR() << logPrefix << "Invalid path length" << endl;
         return ValidationResult::Error;
     }
 
     tid = path.substr(path.length() - 36, 32);
-    Logger::get().debug() << logPrefix << "Title ID: " << tid << endl;
+    LOG_DEBUG() << logPrefix << "Title ID: " << tid << endl;
 
     isMovie = path.back() == '4';
     // Check target-specific config to determine whether this type is allowed to
     // upload
     const bool shouldUpload = isMovie ? uploadMovies : uploadScreenshots;
     if (!shouldUpload) {
-        Logger::get().info()
-            << logPrefix << "Skipping upload for " << path << endl;
+        LOG_INFO() << logPrefix << "Skipping upload for " << path << endl;
         return ValidationResult::Skip;
     }
 
     return ValidationResult::Success;
 }
 
-// Helper to configure CURL timeouts based on file type
-inline void setCurlTimeouts(CURL* curl, bool isVideo) {
+// Helper to configure CURL timeouts based on file type; a request carrying
+// several files gets the total time of all of them
+inline void setCurlTimeouts(CURL* curl, bool isVideo, long fileCount = 1) {
     if (isVideo) {
         curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT,
                          VideoTimeouts::connectTimeout);
@@ -109,29 +668,188 @@ inline void setCurlTimeouts(CURL* curl, bool isVideo) {
                          VideoTimeouts::idleTimeout);
         curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT,
                          1L);  // At least 1 byte/sec
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, VideoTimeouts::totalTimeout);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT,
+                         VideoTimeouts::totalTimeout * fileCount);
     } else {
         curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT,
                          ImageTimeouts::connectTimeout);
         curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME,
                          ImageTimeouts::idleTimeout);
         curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, ImageTimeouts::totalTimeout);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT,
+                         ImageTimeouts::totalTimeout * fileCount);
     }
 }
 
-}  // namespace
+// One HTTP request of a fan-out upload. A batched request streams several
+// files, one form part (and read state) each.
+struct Transfer {
+    UploadChannel channel;
+    size_t handleSlot;
+    std::string_view logPrefix;
+    CURL* curl;
+    UploadInfo info[MAX_BATCH_SIZE];
+    size_t partCount;
+    std::string url;
+    std::string filename;
+    struct curl_slist* headers;
+    curl_mime* form;
+    bool isVideo;     // Picks the transfer profile
+    long sendBuffer;  // SO_SNDBUF for a connection opened by this transfer
+    CURLcode result;
+};
+
+// Size the send buffer of a connection as it is opened
+int applySendBuffer(void* data, curl_socket_t fd,
+                    curlsocktype purpose) noexcept {
+    const auto* t = static_cast<const Transfer*>(data);
+    if (purpose != CURLSOCKTYPE_IPCXN) return CURL_SOCKOPT_OK;
+
+    const int size = static_cast<int>(t->sendBuffer);
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) != 0) {
+        LOG_WARN() << t->logPrefix << "setsockopt(SO_SNDBUF, " << size
+                   << ") failed" << endl;
+    }
+    g_connectionSendBuffer[static_cast<size_t>(t->channel)] = t->sendBuffer;
+    return CURL_SOCKOPT_OK;
+}
 
-bool sendFileToTelegram(std::string_view path, size_t size, bool compression) {
+// Apply a transfer profile. A pooled connection that was opened with a
+// smaller send buffer is not reused, so the first video after screenshots
+// gets its own connection.
+void setTransferProfile(Transfer& t,
+                        const TransferProfileSettings& profile) noexcept {
+    curl_easy_setopt(t.curl, CURLOPT_BUFFERSIZE, profile.receiveBuffer);
+    curl_easy_setopt(t.curl, CURLOPT_UPLOAD_BUFFERSIZE, profile.uploadBuffer);
+
+    t.sendBuffer = profile.sendBuffer;
+    curl_easy_setopt(t.curl, CURLOPT_SOCKOPTFUNCTION, applySendBuffer);
+    curl_easy_setopt(t.curl, CURLOPT_SOCKOPTDATA, &t);
+    if (profile.sendBuffer >
+        g_connectionSendBuffer[static_cast<size_t>(t.channel)]) {
+        curl_easy_setopt(t.curl, CURLOPT_FRESH_CONNECT, 1L);
+    }
+}
+
+// Heap the buffers of one upload may take: the curl buffers of its
+// transfers and the read windows of the files streaming at the same time.
+// What the socket transfer memory leaves of the heap also has to hold the
+// TLS state of every connection and the rest of the sysmodule.
+constexpr size_t TRANSFER_BUFFER_BUDGET = 0x28000;  // 160KB
+
+constexpr size_t bufferCost(const TransferProfileSettings& profile,
+                            size_t transfers, size_t readers) noexcept {
+    return transfers * static_cast<size_t>(profile.uploadBuffer +
+                                           profile.receiveBuffer) +
+           readers * 2 * profile.readWindow;
+}
+
+// Every profile fits for a single transfer, small for all of them
+static_assert(bufferCost(LARGE_PROFILE, 1, 1) <= TRANSFER_BUFFER_BUDGET);
+static_assert(bufferCost(SMALL_PROFILE, MAX_TRANSFERS, 1) <=
+              TRANSFER_BUFFER_BUDGET);
+
+// The configured profile, or the largest smaller one that fits the budget
+// with `transfers` running over `readers` files. Small is what uploads used
+// before there were profiles and is kept even over the budget.
+const TransferProfileSettings& budgetedProfile(bool isVideo, size_t transfers,
+                                               size_t readers) noexcept {
+    const TransferProfileSettings* profile = &transferProfile(isVideo);
+    if (profile == &LARGE_PROFILE &&
+        bufferCost(*profile, transfers, readers) > TRANSFER_BUFFER_BUDGET) {
+        profile = &MEDIUM_PROFILE;
+    }
+    if (profile == &MEDIUM_PROFILE &&
+        bufferCost(*profile, transfers, readers) > TRANSFER_BUFFER_BUDGET) {
+        profile = &SMALL_PROFILE;
+    }
+    return *profile;
+}
+
+// Give the transfers of one upload (all of the same file type) and the
+// files they read the profile that fits the budget. A transfer streams one
+// file at a time, so no more files than transfers hold windows at once.
+void applyTransferProfile(Transfer* transfers, size_t count) noexcept {
+    if (count == 0) return;
+
+    SharedReader* readers[MAX_TRANSFERS * MAX_BATCH_SIZE];
+    size_t readerCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t p = 0; p < transfers[i].partCount; ++p) {
+            SharedReader* reader = transfers[i].info[p].reader;
+            if (std::find(readers, readers + readerCount, reader) ==
+                readers + readerCount) {
+                readers[readerCount++] = reader;
+            }
+        }
+    }
+
+    const bool isVideo = transfers[0].isVideo;
+    const TransferProfileSettings& profile =
+        budgetedProfile(isVideo, count, std::min(readerCount, count));
+    if (&profile != &transferProfile(isVideo)) {
+        LOG_INFO() << "[Upload] Using smaller buffers for " << count
+                   << " transfers to stay within "
+                   << TRANSFER_BUFFER_BUDGET / 1024 << "KB" << endl;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        setTransferProfile(transfers[i], profile);
+    }
+    for (size_t r = 0; r < readerCount; ++r) {
+        readers[r]->setWindowSize(profile.readWindow);
+    }
+}
+
+// Add form part `p` of a transfer, streamed from its reader. Parts of the
+// mime API can be rewound, unlike CURLFORM_STREAM ones.
+void addFilePart(Transfer& t, size_t p, const char* name, const char* filename,
+                 const char* contentType = nullptr) {
+    curl_mimepart* part = curl_mime_addpart(t.form);
+    curl_mime_name(part, name);
+    curl_mime_filename(part, filename);
+    if (contentType) curl_mime_type(part, contentType);
+    curl_mime_data_cb(part, static_cast<curl_off_t>(t.info[p].reader->size()),
+                      uploadReadFunction, uploadSeekFunction, nullptr,
+                      &t.info[p]);
+}
+
+// Setup result for a single channel transfer
+enum class SetupResult {
+    Ready,  // Transfer configured and ready to run
+    Skip,   // Nothing to send for this channel (per config)
+    Error   // Transfer could not be configured
+};
+
+// Log the effective CURL configuration of a transfer
+void logCurlConfig(std::string_view logPrefix, bool isMovie) {
+    LOG_DEBUG() << logPrefix << "CURL config - File type: "
+                << (isMovie ? "video" : "image") << ", Connect timeout: "
+                << (isMovie ? VideoTimeouts::connectTimeout
+                            : ImageTimeouts::connectTimeout)
+                << "s, Idle timeout: "
+                << (isMovie ? VideoTimeouts::idleTimeout
+                            : ImageTimeouts::idleTimeout)
+                << "s, Total timeout: "
+                << (isMovie ? VideoTimeouts::totalTimeout
+                            : ImageTimeouts::totalTimeout)
+                << "s" << endl;
+}
+
+// A `part` is always sent as a document, whatever upload_mode says
+SetupResult setupTelegram(Transfer& t, SharedReader& original,
+                          TranscodedFiles& transcoded, std::string_view path,
+                          bool compression, const FilePart* part = nullptr) {
     constexpr std::string_view logPrefix = "[Telegram] ";
     std::string_view tid;
     bool isMovie;
+    const size_t originalSize = original.size();
 
-    Logger::get().info() << logPrefix << "Starting upload - File: " << path
-                         << ", Size: " << size << " bytes ("
-                         << (size / 1024.0 / 1024.0) << " MB)"
-                         << ", Compression: "
-                         << (compression ? "enabled" : "disabled") << endl;
+    LOG_INFO() << logPrefix << "Starting upload - File: " << path << ", Size: "
+               << originalSize << " bytes ("
+               << (originalSize / 1024.0 / 1024.0) << " MB)"
+               << ", Compression: " << (compression ? "enabled" : "disabled")
+               << endl;
 
     // Validate file and check if upload is needed
     const auto validationResult =
@@ -139,329 +857,380 @@ bool sendFileToTelegram(std::string_view path, size_t size, bool compression) {
                            Config::get().telegramUploadScreenshots(),
                            Config::get().telegramUploadMovies());
     if (validationResult == ValidationResult::Error) {
-        return false;
+        return SetupResult::Error;
     }
     if (validationResult == ValidationResult::Skip) {
-        return true;  // Not an error, just skipping per config
+        return SetupResult::Skip;  // Not an error, just skipping per config
     }
 
+    // The original upload is sent untouched
+    SharedReader& reader =
+        compression ? transcoded.select(UploadChannel::Telegram, original)
+                    : original;
+
     const fs::path filePath{path};
-    const auto fileTypeInfo =
+    auto fileTypeInfo =
         getFileTypeInfo(filePath.extension().string(), compression);
 
     if (fileTypeInfo.contentType.empty()) {
-        Logger::get().error() << logPrefix << "Unknown file extension: "
-                              << filePath.extension().string() << endl;
-        return false;
+        LOG_ERROR() << logPrefix << "Unknown file extension: "
+                    << filePath.extension().string() << endl;
+        return SetupResult::Error;
     }
-
-    FILE* f = std::fopen(filePath.c_str(), "rb");
-    if (f == nullptr) {
-        Logger::get().error()
-            << logPrefix << "fopen() failed for file: " << path << endl;
-        return false;
+    if (part) fileTypeInfo.contentType = PART_CONTENT_TYPE;
+
+    t.channel = UploadChannel::Telegram;
+    t.handleSlot = compression ? 0 : 1;
+    t.logPrefix = logPrefix;
+    t.curl = acquireHandle(t.channel, t.handleSlot);
+    if (!t.curl) {
+        LOG_ERROR() << logPrefix << "curl_easy_init() failed" << endl;
+        return SetupResult::Error;
     }
 
-    UploadInfo ui{f, size};
-    struct curl_httppost* formpost = nullptr;
-    struct curl_httppost* lastptr = nullptr;
-
-    curl_formadd(&formpost, &lastptr, CURLFORM_COPYNAME,
-                 fileTypeInfo.copyName.data(), CURLFORM_FILENAME,
-                 filePath.c_str(), CURLFORM_STREAM, &ui,
-                 CURLFORM_CONTENTSLENGTH, size, CURLFORM_CONTENTTYPE,
-                 fileTypeInfo.contentType.data(), CURLFORM_END);
+    reader.addConsumer(t.info[0]);
+    t.partCount = 1;
+    t.filename = part ? partName(path, *part) : std::string{path};
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::fclose(f);
-        curl_formfree(formpost);
-        Logger::get().error() << logPrefix << "curl_easy_init() failed" << endl;
-        return false;
-    }
+    t.form = curl_mime_init(t.curl);
+    addFilePart(t, 0, fileTypeInfo.copyName.data(), t.filename.c_str(),
+                fileTypeInfo.contentType.data());
 
     // Build URL
     const auto apiUrl = Config::get().getTelegramApiUrl();
     const auto botToken = Config::get().getTelegramBotToken();
     const auto chatId = Config::get().getTelegramChatId();
 
-    std::string url;
-    url.reserve(apiUrl.size() + botToken.size() + chatId.size() +
-                fileTypeInfo.telegramMethod.size() + 20);
-    url = apiUrl;
-    url += "/bot";
-    url += botToken;
-    url += "/";
-    url += fileTypeInfo.telegramMethod;
-    url += "?chat_id=";
-    url += chatId;
-
-    Logger::get().debug() << logPrefix << "URL is " << url << endl;
-
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_READFUNCTION, uploadReadFunction);
-    curl_easy_setopt(curl, CURLOPT_HTTPPOST, formpost);
-    curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, NX_CURL_BUFFERSIZE);
-    curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE,
-                     NX_CURL_UPLOAD_BUFFERSIZE);
-    setCurlTimeouts(curl, isMovie);
-
-    Logger::get().debug() << logPrefix << "CURL config - File type: "
-                          << (isMovie ? "video" : "image")
-                          << ", Connect timeout: "
-                          << (isMovie ? VideoTimeouts::connectTimeout
-                                      : ImageTimeouts::connectTimeout)
-                          << "s, Idle timeout: "
-                          << (isMovie ? VideoTimeouts::idleTimeout
-                                      : ImageTimeouts::idleTimeout)
-                          << "s, Total timeout: "
-                          << (isMovie ? VideoTimeouts::totalTimeout
-                                      : ImageTimeouts::totalTimeout)
-                          << "s" << endl;
-    Logger::get().info() << logPrefix << "Starting CURL transfer..." << endl;
-
-    const CURLcode res = curl_easy_perform(curl);
-    std::fclose(f);
-
-    if (res == CURLE_OK) {
-        long responseCode;
-        double requestSize;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
-        curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &requestSize);
-
-        Logger::get().debug()
-            << logPrefix << requestSize
-            << " bytes sent, response code: " << responseCode << endl;
-
-        curl_easy_cleanup(curl);
-        curl_formfree(formpost);
-
-        if (responseCode == 200) {
-            Logger::get().info()
-                << logPrefix << "Successfully uploaded " << path << endl;
-            return true;
-        }
-
-        Logger::get().error()
-            << logPrefix << "HTTP error - Response code: " << responseCode
-            << ", File: " << path << ", Size: " << size << " bytes" << endl;
-        return false;
-    } else {
-        double requestSize = 0;
-        curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &requestSize);
-        Logger::get().error()
-            << logPrefix << "CURL error: " << curl_easy_strerror(res)
-            << " (code: " << res << ")"
-            << ", Bytes sent: " << requestSize << ", File: " << path << endl;
-        curl_easy_cleanup(curl);
-        curl_formfree(formpost);
-        return false;
-    }
+    t.url.reserve(apiUrl.size() + botToken.size() + chatId.size() +
+                  fileTypeInfo.telegramMethod.size() + 20);
+    t.url = apiUrl;
+    t.url += "/bot";
+    t.url += botToken;
+    t.url += "/";
+    t.url += fileTypeInfo.telegramMethod;
+    t.url += "?chat_id=";
+    t.url += chatId;
+
+    LOG_DEBUG() << logPrefix << "URL is " << t.url << endl;
+
+    curl_easy_setopt(t.curl, CURLOPT_URL, t.url.c_str());
+    curl_easy_setopt(t.curl, CURLOPT_MIMEPOST, t.form);
+    t.isVideo = isMovie;
+    setCurlTimeouts(t.curl, isMovie);
+
+    logCurlConfig(logPrefix, isMovie);
+    return SetupResult::Ready;
 }
 
-bool sendFileToNtfy(std::string_view path, size_t size) {
+SetupResult setupNtfy(Transfer& t, SharedReader& original,
+                      TranscodedFiles& transcoded, std::string_view path,
+                      const FilePart* part = nullptr) {
     constexpr std::string_view logPrefix = "[ntfy] ";
     std::string_view tid;
     bool isMovie;
 
-    Logger::get().info() << logPrefix << "Starting upload - File: " << path
-                         << ", Size: " << size << " bytes ("
-                         << (size / 1024.0 / 1024.0) << " MB)" << endl;
+    LOG_INFO() << logPrefix << "Starting upload - File: " << path << ", Size: "
+               << original.size() << " bytes ("
+               << (original.size() / 1024.0 / 1024.0) << " MB)" << endl;
 
     // Validate file and check if upload is needed
     const auto validationResult = validateUploadFile(
         path, logPrefix, tid, isMovie, Config::get().ntfyUploadScreenshots(),
         Config::get().ntfyUploadMovies());
     if (validationResult == ValidationResult::Error) {
-        return false;
+        return SetupResult::Error;
     }
     if (validationResult == ValidationResult::Skip) {
-        return true;  // Not an error, just skipping per config
+        return SetupResult::Skip;  // Not an error, just skipping per config
     }
 
-    const fs::path filePath{path};
-    const std::string filename = filePath.filename().string();
-
-    FILE* f = std::fopen(filePath.c_str(), "rb");
-    if (f == nullptr) {
-        Logger::get().error()
-            << logPrefix << "fopen() failed for file: " << path << endl;
-        return false;
-    }
-
-    UploadInfo ui{f, size};
-
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::fclose(f);
-        Logger::get().error() << logPrefix << "curl_easy_init() failed" << endl;
-        return false;
-    }
+    SharedReader& reader = transcoded.select(UploadChannel::Ntfy, original);
+    const size_t size = reader.size();
 
     // Build URL
     const auto ntfyUrl = Config::get().getNtfyUrl();
     const auto topic = Config::get().getNtfyTopic();
 
     if (topic.empty()) {
-        std::fclose(f);
-        curl_easy_cleanup(curl);
-        Logger::get().error() << logPrefix << "Topic is not configured" << endl;
-        return false;
+        LOG_ERROR() << logPrefix << "Topic is not configured" << endl;
+        return SetupResult::Error;
     }
 
-    std::string url;
-    url.reserve(ntfyUrl.size() + topic.size() + 2);
-    url = ntfyUrl;
-    url += "/";
-    url += topic;
+    t.channel = UploadChannel::Ntfy;
+    t.handleSlot = 0;
+    t.logPrefix = logPrefix;
+    t.curl = acquireHandle(t.channel);
+    if (!t.curl) {
+        LOG_ERROR() << logPrefix << "curl_easy_init() failed" << endl;
+        return SetupResult::Error;
+    }
+
+    reader.addConsumer(t.info[0]);
+    t.partCount = 1;
+    t.filename =
+        part ? partName(path, *part) : fs::path{path}.filename().string();
+
+    t.url.reserve(ntfyUrl.size() + topic.size() + 2);
+    t.url = ntfyUrl;
+    t.url += "/";
+    t.url += topic;
 
     // url will expose bot token in logs, so avoid logging it
-    // Logger::get().debug() << logPrefix << "URL is " << url << endl;
+    // Logger::get().debug() << logPrefix << "URL is " << t.url << endl;
 
     // Build headers
-    struct curl_slist* headers = nullptr;
-
     std::string filenameHeader = "Filename: ";
-    filenameHeader += filename;
-    headers = curl_slist_append(headers, filenameHeader.c_str());
+    filenameHeader += t.filename;
+    t.headers = curl_slist_append(t.headers, filenameHeader.c_str());
 
     const auto token = Config::get().getNtfyToken();
     if (!token.empty()) {
         std::string authHeader = "Authorization: Bearer ";
         authHeader += token;
-        headers = curl_slist_append(headers, authHeader.c_str());
+        t.headers = curl_slist_append(t.headers, authHeader.c_str());
     }
 
     const auto priority = Config::get().getNtfyPriority();
     if (!priority.empty() && priority != "default") {
         std::string priorityHeader = "Priority: ";
         priorityHeader += priority;
-        headers = curl_slist_append(headers, priorityHeader.c_str());
+        t.headers = curl_slist_append(t.headers, priorityHeader.c_str());
     }
 
     std::string titleHeader = "Title: Screenshot from ";
     titleHeader += tid;
-    headers = curl_slist_append(headers, titleHeader.c_str());
+    if (part) {
+        titleHeader += " (part ";
+        titleHeader += std::to_string(part->index + 1);
+        titleHeader += "/";
+        titleHeader += std::to_string(part->count);
+        titleHeader += ")";
+    }
+    t.headers = curl_slist_append(t.headers, titleHeader.c_str());
 
     // Configure CURL for PUT upload
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
-    curl_easy_setopt(curl, CURLOPT_READFUNCTION, uploadReadFunction);
-    curl_easy_setopt(curl, CURLOPT_READDATA, &ui);
-    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
+    curl_easy_setopt(t.curl, CURLOPT_URL, t.url.c_str());
+    curl_easy_setopt(t.curl, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt(t.curl, CURLOPT_READFUNCTION, uploadReadFunction);
+    curl_easy_setopt(t.curl, CURLOPT_READDATA, &t.info[0]);
+    curl_easy_setopt(t.curl, CURLOPT_SEEKFUNCTION, uploadSeekFunction);
+    curl_easy_setopt(t.curl, CURLOPT_SEEKDATA, &t.info[0]);
+    curl_easy_setopt(t.curl, CURLOPT_INFILESIZE_LARGE,
                      static_cast<curl_off_t>(size));
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, NX_CURL_BUFFERSIZE);
-    curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE,
-                     NX_CURL_UPLOAD_BUFFERSIZE);
-    setCurlTimeouts(curl, isMovie);
-
-    Logger::get().debug() << logPrefix << "CURL config - File type: "
-                          << (isMovie ? "video" : "image")
-                          << ", Connect timeout: "
-                          << (isMovie ? VideoTimeouts::connectTimeout
-                                      : ImageTimeouts::connectTimeout)
-                          << "s, Idle timeout: "
-                          << (isMovie ? VideoTimeouts::idleTimeout
-                                      : ImageTimeouts::idleTimeout)
-                          << "s, Total timeout: "
-                          << (isMovie ? VideoTimeouts::totalTimeout
-                                      : ImageTimeouts::totalTimeout)
-                          << "s" << endl;
-    Logger::get().info() << logPrefix << "Starting CURL transfer..." << endl;
-
-    const CURLcode res = curl_easy_perform(curl);
-    std::fclose(f);
-
-    if (res == CURLE_OK) {
-        long responseCode;
-        double requestSize;
-        double totalTime;
-        double uploadSpeed;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
-        curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &requestSize);
-        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &totalTime);
-        curl_easy_getinfo(curl, CURLINFO_SPEED_UPLOAD, &uploadSpeed);
-
-        Logger::get().info()
-            << logPrefix << "Transfer complete - " << requestSize
-            << " bytes sent (" << (requestSize / 1024.0 / 1024.0) << " MB), "
-            << "Response code: " << responseCode << ", "
-            << "Time: " << totalTime << "s, "
-            << "Speed: " << (uploadSpeed / 1024.0) << " KB/s" << endl;
-
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-
-        if (responseCode == 200) {
-            Logger::get().info()
-                << logPrefix << "Successfully uploaded " << path << endl;
-            return true;
-        }
+    curl_easy_setopt(t.curl, CURLOPT_HTTPHEADER, t.headers);
+    t.isVideo = isMovie;
+    setCurlTimeouts(t.curl, isMovie);
 
-        Logger::get().error()
-            << logPrefix << "HTTP error - Response code: " << responseCode
-            << ", File: " << path << ", Size: " << size << " bytes" << endl;
-        return false;
-    } else {
-        double requestSize = 0;
-        curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &requestSize);
-        Logger::get().error()
-            << logPrefix << "CURL error: " << curl_easy_strerror(res)
-            << " (code: " << res << ")"
-            << ", Bytes sent: " << requestSize << ", File: " << path << endl;
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        return false;
-    }
+    logCurlConfig(logPrefix, isMovie);
+    return SetupResult::Ready;
 }
 
-bool sendFileToDiscord(std::string_view path, size_t size) {
+SetupResult setupDiscord(Transfer& t, SharedReader& original,
+                         TranscodedFiles& transcoded, std::string_view path,
+                         const FilePart* part = nullptr) {
     constexpr std::string_view logPrefix = "[Discord] ";
     std::string_view tid;
     bool isMovie;
 
-    Logger::get().info() << logPrefix << "Starting upload - File: " << path
-                         << ", Size: " << size << " bytes ("
-                         << (size / 1024.0 / 1024.0) << " MB)" << endl;
+    LOG_INFO() << logPrefix << "Starting upload - File: " << path << ", Size: "
+               << original.size() << " bytes ("
+               << (original.size() / 1024.0 / 1024.0) << " MB)" << endl;
 
     // Validate file and check if upload is needed
     const auto validationResult = validateUploadFile(
         path, logPrefix, tid, isMovie, Config::get().discordUploadScreenshots(),
         Config::get().discordUploadMovies());
     if (validationResult == ValidationResult::Error) {
-        return false;
+        return SetupResult::Error;
     }
     if (validationResult == ValidationResult::Skip) {
-        return true;  // Not an error, just skipping per config
+        return SetupResult::Skip;  // Not an error, just skipping per config
     }
 
-    const fs::path filePath{path};
-    const std::string filename = filePath.filename().string();
+    SharedReader& reader = transcoded.select(UploadChannel::Discord, original);
+
+    t.channel = UploadChannel::Discord;
+    t.handleSlot = 0;
+    t.logPrefix = logPrefix;
+    t.curl = acquireHandle(t.channel);
+    if (!t.curl) {
+        LOG_ERROR() << logPrefix << "curl_easy_init() failed" << endl;
+        return SetupResult::Error;
+    }
+
+    reader.addConsumer(t.info[0]);
+    t.partCount = 1;
+    t.filename =
+        part ? partName(path, *part) : fs::path{path}.filename().string();
+
+    t.form = curl_mime_init(t.curl);
+    addFilePart(t, 0, "files[0]", t.filename.c_str());
+
+    // Build URL
+    const auto apiUrl = Config::get().getDiscordApiUrl();
+    const auto botToken = Config::get().getDiscordBotToken();
+    const auto channelId = Config::get().getDiscordChannelId();
+
+    t.url.reserve(apiUrl.size() + channelId.size() + 20);
+    t.url = apiUrl;
+    t.url += "/channels/";
+    t.url += channelId;
+    t.url += "/messages";
+
+    LOG_DEBUG() << logPrefix << "URL is " << t.url << endl;
+
+    // Build headers
+    std::string authHeader = "Authorization: Bot ";
+    authHeader += botToken;
+    t.headers = curl_slist_append(t.headers, authHeader.c_str());
 
-    FILE* f = std::fopen(filePath.c_str(), "rb");
-    if (f == nullptr) {
-        Logger::get().error()
-            << logPrefix << "fopen() failed for file: " << path << endl;
-        return false;
+    curl_easy_setopt(t.curl, CURLOPT_URL, t.url.c_str());
+    curl_easy_setopt(t.curl, CURLOPT_HTTPHEADER, t.headers);
+    curl_easy_setopt(t.curl, CURLOPT_MIMEPOST, t.form);
+    t.isVideo = isMovie;
+    setCurlTimeouts(t.curl, isMovie);
+
+    logCurlConfig(logPrefix, isMovie);
+    return SetupResult::Ready;
+}
+
+// File name part of an album path (points into `path`)
+const char* baseName(const char* path) noexcept {
+    const char* slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Total size of the files of a batch
+size_t batchSize(BatchItem* const* group, size_t count) noexcept {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) total += group[i]->size;
+    return total;
+}
+
+// One sendMediaGroup request carrying every screenshot of the batch, each
+// file streamed as its own attach:// part
+SetupResult setupTelegramBatch(Transfer& t, SharedReader* originals,
+                               TranscodedFiles& transcoded,
+                               BatchItem* const* group, size_t count,
+                               bool compression) {
+    constexpr std::string_view logPrefix = "[Telegram] ";
+    const size_t size = batchSize(group, count);
+
+    LOG_INFO() << logPrefix << "Starting batch upload - " << count
+               << " files, Size: " << size << " bytes ("
+               << (size / 1024.0 / 1024.0) << " MB)"
+               << ", Compression: " << (compression ? "enabled" : "disabled")
+               << endl;
+
+    if (!Config::get().telegramUploadScreenshots()) {
+        LOG_INFO() << logPrefix << "Skipping batch of " << count
+                   << " screenshots" << endl;
+        return SetupResult::Skip;
     }
 
-    UploadInfo ui{f, size};
-    struct curl_httppost* formpost = nullptr;
-    struct curl_httppost* lastptr = nullptr;
+    // The original upload is sent untouched
+    SharedReader* readers[MAX_BATCH_SIZE];
+    if (compression) {
+        transcoded.select(UploadChannel::Telegram, originals, count, readers);
+    } else {
+        for (size_t i = 0; i < count; ++i) readers[i] = &originals[i];
+    }
 
-    curl_formadd(&formpost, &lastptr, CURLFORM_COPYNAME, "files[0]",
-                 CURLFORM_FILENAME, filePath.filename().string().c_str(),
-                 CURLFORM_STREAM, &ui, CURLFORM_CONTENTSLENGTH, size,
-                 CURLFORM_END);
+    t.channel = UploadChannel::Telegram;
+    t.handleSlot = compression ? 0 : 1;
+    t.logPrefix = logPrefix;
+    t.curl = acquireHandle(t.channel, t.handleSlot);
+    if (!t.curl) {
+        LOG_ERROR() << logPrefix << "curl_easy_init() failed" << endl;
+        return SetupResult::Error;
+    }
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::fclose(f);
-        curl_formfree(formpost);
-        Logger::get().error() << logPrefix << "curl_easy_init() failed" << endl;
-        return false;
+    // Media descriptions reference the file parts by name
+    const std::string_view mediaType = compression ? "photo" : "document";
+    std::string media = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) media += ',';
+        media += "{\"type\":\"";
+        media += mediaType;
+        media += "\",\"media\":\"attach://file";
+        media += std::to_string(i);
+        media += "\"}";
+    }
+    media += ']';
+
+    t.form = curl_mime_init(t.curl);
+    curl_mimepart* mediaPart = curl_mime_addpart(t.form);
+    curl_mime_name(mediaPart, "media");
+    curl_mime_data(mediaPart, media.c_str(), CURL_ZERO_TERMINATED);
+
+    t.partCount = count;
+    for (size_t i = 0; i < count; ++i) {
+        readers[i]->addConsumer(t.info[i]);
+        const std::string partName = "file" + std::to_string(i);
+        addFilePart(t, i, partName.c_str(), baseName(group[i]->path),
+                    "image/jpeg");
+    }
+
+    // Build URL
+    const auto apiUrl = Config::get().getTelegramApiUrl();
+    const auto botToken = Config::get().getTelegramBotToken();
+    const auto chatId = Config::get().getTelegramChatId();
+
+    constexpr std::string_view method = "sendMediaGroup";
+    t.url.reserve(apiUrl.size() + botToken.size() + chatId.size() +
+                  method.size() + 20);
+    t.url = apiUrl;
+    t.url += "/bot";
+    t.url += botToken;
+    t.url += "/";
+    t.url += method;
+    t.url += "?chat_id=";
+    t.url += chatId;
+
+    curl_easy_setopt(t.curl, CURLOPT_URL, t.url.c_str());
+    curl_easy_setopt(t.curl, CURLOPT_MIMEPOST, t.form);
+    t.isVideo = false;
+    setCurlTimeouts(t.curl, false, static_cast<long>(count));
+
+    logCurlConfig(logPrefix, false);
+    return SetupResult::Ready;
+}
+
+// One Discord message with every screenshot of the batch as files[0..n]
+SetupResult setupDiscordBatch(Transfer& t, SharedReader* originals,
+                              TranscodedFiles& transcoded,
+                              BatchItem* const* group, size_t count) {
+    constexpr std::string_view logPrefix = "[Discord] ";
+    const size_t size = batchSize(group, count);
+
+    LOG_INFO() << logPrefix << "Starting batch upload - " << count
+               << " files, Size: " << size << " bytes ("
+               << (size / 1024.0 / 1024.0) << " MB)" << endl;
+
+    if (!Config::get().discordUploadScreenshots()) {
+        LOG_INFO() << logPrefix << "Skipping batch of " << count
+                   << " screenshots" << endl;
+        return SetupResult::Skip;
+    }
+
+    SharedReader* readers[MAX_BATCH_SIZE];
+    transcoded.select(UploadChannel::Discord, originals, count, readers);
+
+    t.channel = UploadChannel::Discord;
+    t.handleSlot = 0;
+    t.logPrefix = logPrefix;
+    t.curl = acquireHandle(t.channel);
+    if (!t.curl) {
+        LOG_ERROR() << logPrefix << "curl_easy_init() failed" << endl;
+        return SetupResult::Error;
+    }
+
+    t.form = curl_mime_init(t.curl);
+    t.partCount = count;
+    for (size_t i = 0; i < count; ++i) {
+        readers[i]->addConsumer(t.info[i]);
+        const std::string partName = "files[" + std::to_string(i) + "]";
+        addFilePart(t, i, partName.c_str(), baseName(group[i]->path));
     }
 
     // Build URL
@@ -469,93 +1238,627 @@ bool sendFileToDiscord(std::string_view path, size_t size) {
     const auto botToken = Config::get().getDiscordBotToken();
     const auto channelId = Config::get().getDiscordChannelId();
 
-    std::string url;
-    url.reserve(apiUrl.size() + channelId.size() + 3);
-    url = apiUrl;
-    url += "/channels/";
-    url += channelId;
-    url += "/messages";
+    t.url.reserve(apiUrl.size() + channelId.size() + 20);
+    t.url = apiUrl;
+    t.url += "/channels/";
+    t.url += channelId;
+    t.url += "/messages";
 
-    Logger::get().debug() << logPrefix << "URL is " << url << endl;
+    LOG_DEBUG() << logPrefix << "URL is " << t.url << endl;
 
     // Build headers
-    struct curl_slist* headers = nullptr;
-
     std::string authHeader = "Authorization: Bot ";
     authHeader += botToken;
-    headers = curl_slist_append(headers, authHeader.c_str());
+    t.headers = curl_slist_append(t.headers, authHeader.c_str());
 
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_READFUNCTION, uploadReadFunction);
-    curl_easy_setopt(curl, CURLOPT_READDATA, &ui);
-    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
-                     static_cast<curl_off_t>(size));
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_HTTPPOST, formpost);
-    curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, NX_CURL_BUFFERSIZE);
-    curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE,
-                     NX_CURL_UPLOAD_BUFFERSIZE);
-    setCurlTimeouts(curl, isMovie);
-
-    Logger::get().debug() << logPrefix << "CURL config - File type: "
-                          << (isMovie ? "video" : "image")
-                          << ", Connect timeout: "
-                          << (isMovie ? VideoTimeouts::connectTimeout
-                                      : ImageTimeouts::connectTimeout)
-                          << "s, Idle timeout: "
-                          << (isMovie ? VideoTimeouts::idleTimeout
-                                      : ImageTimeouts::idleTimeout)
-                          << "s, Total timeout: "
-                          << (isMovie ? VideoTimeouts::totalTimeout
-                                      : ImageTimeouts::totalTimeout)
-                          << "s" << endl;
-    Logger::get().info() << logPrefix << "Starting CURL transfer..." << endl;
-
-    const CURLcode res = curl_easy_perform(curl);
-    std::fclose(f);
-
-    if (res == CURLE_OK) {
+    curl_easy_setopt(t.curl, CURLOPT_URL, t.url.c_str());
+    curl_easy_setopt(t.curl, CURLOPT_HTTPHEADER, t.headers);
+    curl_easy_setopt(t.curl, CURLOPT_MIMEPOST, t.form);
+    t.isVideo = false;
+    setCurlTimeouts(t.curl, false, static_cast<long>(count));
+
+    logCurlConfig(logPrefix, false);
+    return SetupResult::Ready;
+}
+
+// Feed the stage timings of a finished request into the upload stats
+void recordTransferStats(const Transfer& t, bool success) {
+    TransferTimings timings{};
+    curl_off_t bytesSent = 0;
+    curl_easy_getinfo(t.curl, CURLINFO_NAMELOOKUP_TIME_T,
+                      &timings.nameLookupUs);
+    curl_easy_getinfo(t.curl, CURLINFO_CONNECT_TIME_T, &timings.connectUs);
+    curl_easy_getinfo(t.curl, CURLINFO_APPCONNECT_TIME_T,
+                      &timings.appConnectUs);
+    curl_easy_getinfo(t.curl, CURLINFO_PRETRANSFER_TIME_T,
+                      &timings.preTransferUs);
+    curl_easy_getinfo(t.curl, CURLINFO_STARTTRANSFER_TIME_T,
+                      &timings.startTransferUs);
+    curl_easy_getinfo(t.curl, CURLINFO_TOTAL_TIME_T, &timings.totalUs);
+    curl_easy_getinfo(t.curl, CURLINFO_SIZE_UPLOAD_T, &bytesSent);
+    statsRecordTransfer(t.channel, timings, static_cast<uint64_t>(bytesSent),
+                        success);
+}
+
+// Inspect the outcome of a finished transfer and release its resources.
+// Returns true if the channel accepted the upload.
+bool finishTransfer(Transfer& t, std::string_view path, size_t size) {
+    const std::string_view logPrefix = t.logPrefix;
+    bool success = false;
+
+    if (t.result == CURLE_OK) {
         long responseCode;
         double requestSize;
         double totalTime;
         double uploadSpeed;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
-        curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &requestSize);
-        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &totalTime);
-        curl_easy_getinfo(curl, CURLINFO_SPEED_UPLOAD, &uploadSpeed);
-
-        Logger::get().info()
-            << logPrefix << "Transfer complete - " << requestSize
-            << " bytes sent (" << (requestSize / 1024.0 / 1024.0) << " MB), "
-            << "Response code: " << responseCode << ", "
-            << "Time: " << totalTime << "s, "
-            << "Speed: " << (uploadSpeed / 1024.0) << " KB/s" << endl;
-
-        curl_easy_cleanup(curl);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
-
-        if (responseCode == 200 || responseCode == 201) {
-            Logger::get().info()
-                << logPrefix << "Successfully uploaded " << path << endl;
-            return true;
+        curl_easy_getinfo(t.curl, CURLINFO_RESPONSE_CODE, &responseCode);
+        curl_easy_getinfo(t.curl, CURLINFO_SIZE_UPLOAD, &requestSize);
+        curl_easy_getinfo(t.curl, CURLINFO_TOTAL_TIME, &totalTime);
+        curl_easy_getinfo(t.curl, CURLINFO_SPEED_UPLOAD, &uploadSpeed);
+
+        LOG_INFO() << logPrefix << "Transfer complete - " << requestSize
+                   << " bytes sent (" << (requestSize / 1024.0 / 1024.0)
+                   << " MB), " << "Response code: " << responseCode << ", "
+                   << "Time: " << totalTime << "s, " << "Speed: "
+                   << (uploadSpeed / 1024.0) << " KB/s" << endl;
+
+        // Discord answers 201 Created for new messages
+        success = responseCode == 200 ||
+                  (t.channel == UploadChannel::Discord && responseCode == 201);
+        if (success) {
+            LOG_INFO() << logPrefix << "Successfully uploaded " << path << endl;
+        } else {
+            LOG_ERROR() << logPrefix << "HTTP error - Response code: "
+                        << responseCode << ", File: " << path << ", Size: "
+                        << size << " bytes" << endl;
         }
 
-        Logger::get().error()
-            << logPrefix << "HTTP error - Response code: " << responseCode
-            << ", File: " << path << ", Size: " << size << " bytes" << endl;
-        return false;
+        // Server errors and rate limiting count against the channel; other
+        // rejections are about this file
+        if (responseCode >= 500 || responseCode == 429) {
+            char error[32];
+            std::snprintf(error, sizeof(error), "HTTP %ld", responseCode);
+            healthRecordFailure(t.channel, error);
+        } else {
+            healthRecordSuccess(t.channel);
+        }
     } else {
         double requestSize = 0;
-        curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &requestSize);
-        Logger::get().error()
-            << logPrefix << "CURL error: " << curl_easy_strerror(res)
-            << " (code: " << res << ")"
-            << ", Bytes sent: " << requestSize << ", File: " << path << endl;
-        curl_easy_cleanup(curl);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
-        return false;
+        curl_easy_getinfo(t.curl, CURLINFO_SIZE_UPLOAD, &requestSize);
+        LOG_ERROR() << logPrefix << "CURL error: "
+                    << curl_easy_strerror(t.result) << " (code: " << t.result
+                    << ")" << ", Bytes sent: " << requestSize << ", File: "
+                    << path << endl;
+        healthRecordFailure(t.channel, curl_easy_strerror(t.result));
+    }
+
+    recordTransferStats(t, success);
+
+    releaseHandle(t.channel, t.handleSlot, t.result);
+    curl_mime_free(t.form);
+    if (t.headers) curl_slist_free_all(t.headers);
+    t.form = nullptr;
+    t.headers = nullptr;
+    return success;
+}
+
+// Mark every part of a finished transfer as done reading
+void deactivate(Transfer& t) noexcept {
+    for (size_t p = 0; p < t.partCount; ++p) {
+        t.info[p].active = false;
+    }
+}
+
+// Upload rate cap in bytes/s under the configured pacing mode, 0 for none
+curl_off_t pacingRateLimit() {
+    const Config& config = Config::get();
+    const std::string_view mode = config.getUploadPacing();
+    if (mode == UploadPacing::Off ||
+        (mode == UploadPacing::InGame && !isApplicationRunning())) {
+        return 0;
+    }
+    return static_cast<curl_off_t>(config.getUploadRateLimitKBps()) * 1024;
+}
+
+// Split the pacing cap across the transfers still running. Curl reads the
+// limit while transferring, so this can tighten or lift it mid-upload.
+void applyPacing(Transfer* transfers, size_t count, curl_off_t limit) {
+    size_t running = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (transfers[i].info[0].active) ++running;
+    }
+
+    const curl_off_t perTransfer =
+        limit > 0 && running > 0
+            ? std::max<curl_off_t>(limit / static_cast<curl_off_t>(running), 1)
+            : 0;
+    for (size_t i = 0; i < count; ++i) {
+        curl_easy_setopt(transfers[i].curl, CURLOPT_MAX_SEND_SPEED_LARGE,
+                         perTransfer);
+        // A paced upload may take longer than the total timeout allows; the
+        // idle timeout still catches stalled connections
+        if (perTransfer > 0) {
+            curl_easy_setopt(transfers[i].curl, CURLOPT_TIMEOUT, 0L);
+        }
+    }
+}
+
+// Run all prepared transfers concurrently until every one has finished
+void runTransfers(Transfer* transfers, size_t count) {
+    if (!g_multi) {
+        g_multi = curl_multi_init();
+    }
+
+    applyTransferProfile(transfers, count);
+
+    curl_off_t rateLimit = pacingRateLimit();
+    applyPacing(transfers, count, rateLimit);
+    u64 pacingCheckTick = armGetSystemTick();
+
+    if (!g_multi) {
+        // Fall back to running the transfers one after another
+        LOG_WARN()
+            << "[Upload] curl_multi_init() failed, uploading sequentially"
+            << endl;
+        for (size_t i = 0; i < count; ++i) {
+            transfers[i].result = curl_easy_perform(transfers[i].curl);
+            deactivate(transfers[i]);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        curl_easy_setopt(transfers[i].curl, CURLOPT_PRIVATE, &transfers[i]);
+        curl_multi_add_handle(g_multi, transfers[i].curl);
+    }
+
+    LOG_INFO() << "[Upload] Starting " << count << " CURL transfer(s)..."
+               << (rateLimit > 0 ? " (paced)" : "") << endl;
+
+    int running = static_cast<int>(count);
+    while (running > 0) {
+        // Follow the pacing mode as games start and stop, and give the
+        // share of finished transfers to the remaining ones
+        if (armTicksToNs(armGetSystemTick() - pacingCheckTick) >=
+            PACING_RECHECK_NS) {
+            pacingCheckTick = armGetSystemTick();
+            rateLimit = pacingRateLimit();
+            applyPacing(transfers, count, rateLimit);
+        }
+
+        const CURLMcode mc = curl_multi_perform(g_multi, &running);
+        if (mc != CURLM_OK) {
+            LOG_ERROR() << "[Upload] curl_multi_perform() failed: "
+                        << curl_multi_strerror(mc) << endl;
+            break;
+        }
+
+        // Collect finished transfers
+        int queued;
+        while (CURLMsg* msg = curl_multi_info_read(g_multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            Transfer* t = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+            if (t) {
+                t->result = msg->data.result;
+                deactivate(*t);
+            }
+            curl_multi_remove_handle(g_multi, msg->easy_handle);
+        }
+
+        // Wake transfers that were waiting for the shared read window
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t p = 0; p < transfers[i].partCount; ++p) {
+                UploadInfo& info = transfers[i].info[p];
+                if (info.active && info.paused &&
+                    info.reader->canResume(info)) {
+                    info.paused = false;
+                    curl_easy_pause(transfers[i].curl, CURLPAUSE_CONT);
+                }
+            }
+        }
+
+        // Curl has handed its data to the sockets; read ahead while they
+        // drain instead of when the next window is requested
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t p = 0; p < transfers[i].partCount; ++p) {
+                const UploadInfo& info = transfers[i].info[p];
+                if (info.active) info.reader->prefetch();
+            }
+        }
+
+        if (running > 0) {
+            curl_multi_poll(g_multi, nullptr, 0, 100, nullptr);
+        }
+    }
+
+    // Detach anything left behind after a multi error
+    for (size_t i = 0; i < count; ++i) {
+        if (transfers[i].info[0].active) {
+            transfers[i].result = CURLE_SEND_ERROR;
+            deactivate(transfers[i]);
+            curl_multi_remove_handle(g_multi, transfers[i].curl);
+        }
+    }
+}
+
+// Upload a file to the channels of the mask in one fan-out, every transfer
+// streaming from the same reader
+ChannelMask uploadWhole(std::string_view path, size_t size,
+                        ChannelMask channels) {
+    const std::string pathStr{path};
+    SharedReader reader(pathStr.c_str(), size);
+    TranscodedFiles transcoded;
+
+    std::array<Transfer, MAX_TRANSFERS> transfers{};
+    size_t count = 0;
+    ChannelMask skipped = 0;
+
+    const auto addTransfer = [&](UploadChannel channel, SetupResult result) {
+        if (result == SetupResult::Ready) {
+            ++count;
+        } else if (result == SetupResult::Skip) {
+            skipped |= channelBit(channel);
+        }
+    };
+
+    if (channels & channelBit(UploadChannel::Telegram)) {
+        const auto mode = Config::get().getTelegramUploadMode();
+        if (mode == UploadMode::Compressed || mode == UploadMode::Both) {
+            addTransfer(UploadChannel::Telegram,
+                        setupTelegram(transfers[count], reader, transcoded,
+                                      path, true));
+        }
+        if (mode == UploadMode::Original || mode == UploadMode::Both) {
+            addTransfer(UploadChannel::Telegram,
+                        setupTelegram(transfers[count], reader, transcoded,
+                                      path, false));
+        }
+    }
+    if (channels & channelBit(UploadChannel::Ntfy)) {
+        addTransfer(UploadChannel::Ntfy,
+                    setupNtfy(transfers[count], reader, transcoded, path));
+    }
+    if (channels & channelBit(UploadChannel::Discord)) {
+        addTransfer(UploadChannel::Discord,
+                    setupDiscord(transfers[count], reader, transcoded, path));
+    }
+
+    if (count > 0) runTransfers(transfers.data(), count);
+
+    // A channel counts as delivered if any of its transfers succeeded (e.g.
+    // either the compressed or the original Telegram upload in "both" mode)
+    ChannelMask succeeded = skipped;
+    for (size_t i = 0; i < count; ++i) {
+        if (finishTransfer(transfers[i], path, size)) {
+            succeeded |= channelBit(transfers[i].channel);
+        }
+    }
+    return succeeded;
+}
+
+// Parts of a split video each channel has delivered. They outlive a failed
+// attempt, so the retry only sends what is missing; the worker handles one
+// video at a time, so a few slots cover the retries that are still due.
+// Nothing is kept across restarts.
+struct PartProgress {
+    std::string path;
+    size_t size;
+    size_t partSize[UPLOAD_CHANNEL_COUNT];
+    uint64_t delivered[UPLOAD_CHANNEL_COUNT];
+};
+
+constexpr size_t PART_PROGRESS_SLOTS = 4;
+PartProgress g_partProgress[PART_PROGRESS_SLOTS];
+size_t g_nextPartProgress = 0;  // Slot reused next, oldest first
+
+// Progress of a file, starting from no parts if it has none yet
+PartProgress& partProgress(std::string_view path, size_t size) {
+    for (PartProgress& progress : g_partProgress) {
+        if (progress.path == path && progress.size == size) return progress;
+    }
+
+    PartProgress& progress = g_partProgress[g_nextPartProgress];
+    g_nextPartProgress = (g_nextPartProgress + 1) % PART_PROGRESS_SLOTS;
+    progress = PartProgress{std::string{path}, size, {}, {}};
+    return progress;
+}
+
+// Part size of a video sent to a channel, or 0 to send it whole
+size_t videoPartSize(UploadChannel channel, size_t size) {
+    const Config& config = Config::get();
+    int megabytes = 0;
+    switch (channel) {
+        case UploadChannel::Telegram:
+            megabytes = config.getTelegramVideoPartSizeMB();
+            break;
+        case UploadChannel::Ntfy:
+            megabytes = config.getNtfyVideoPartSizeMB();
+            break;
+        case UploadChannel::Discord:
+            megabytes = config.getDiscordVideoPartSizeMB();
+            break;
+    }
+
+    const size_t partSize = static_cast<size_t>(megabytes) * 1024 * 1024;
+    if (partSize == 0 || size <= partSize) return 0;
+
+    // Larger parts than configured rather than more than there is progress
+    // for
+    const size_t smallest = (size + MAX_VIDEO_PARTS - 1) / MAX_VIDEO_PARTS;
+    if (partSize >= smallest) return partSize;
+    return (smallest + VIDEO_PART_ALIGNMENT - 1) / VIDEO_PART_ALIGNMENT *
+           VIDEO_PART_ALIGNMENT;
+}
+
+// Send the parts of a video a channel is still missing, one request each.
+// Stops at the first part that fails and leaves the rest to the retry.
+// Returns true once every part was delivered (or the channel skips videos).
+bool uploadParts(std::string_view path, size_t size, UploadChannel channel,
+                 size_t partSize) {
+    const std::string pathStr{path};
+    const size_t index = static_cast<size_t>(channel);
+    PartProgress& progress = partProgress(path, size);
+    if (progress.partSize[index] != partSize) {
+        // The part size changed with the config; start over
+        progress.partSize[index] = partSize;
+        progress.delivered[index] = 0;
+    }
+    uint64_t& delivered = progress.delivered[index];
+
+    const size_t count = (size + partSize - 1) / partSize;
+    LOG_INFO() << "[Upload] Sending " << path << " to " << channelName(channel)
+               << " in " << count << " parts of up to " << partSize
+               << " bytes (" << std::popcount(delivered) << " already sent)"
+               << endl;
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t bit = uint64_t{1} << i;
+        if (delivered & bit) continue;
+
+        const size_t offset = i * partSize;
+        const size_t length = std::min(partSize, size - offset);
+        SharedReader reader(pathStr.c_str(), length, offset);
+        TranscodedFiles transcoded;
+        Transfer t{};
+        const FilePart part{i, count};
+
+        SetupResult result = SetupResult::Error;
+        switch (channel) {
+            case UploadChannel::Telegram:
+                result = setupTelegram(t, reader, transcoded, path, false,
+                                       &part);
+                break;
+            case UploadChannel::Ntfy:
+                result = setupNtfy(t, reader, transcoded, path, &part);
+                break;
+            case UploadChannel::Discord:
+                result = setupDiscord(t, reader, transcoded, path, &part);
+                break;
+        }
+        if (result == SetupResult::Skip) return true;
+        if (result == SetupResult::Error) return false;
+
+        runTransfers(&t, 1);
+        if (!finishTransfer(t, t.filename, length)) return false;
+        delivered |= bit;
+    }
+
+    // Sent in full; a later upload of the same file starts from scratch
+    delivered = 0;
+    return true;
+}
+
+}  // namespace
+
+ChannelMask uploadEnabledChannels() {
+    ChannelMask channels = 0;
+    if (Config::get().telegramEnabled())
+        channels |= channelBit(UploadChannel::Telegram);
+    if (Config::get().ntfyEnabled())
+        channels |= channelBit(UploadChannel::Ntfy);
+    if (Config::get().discordEnabled())
+        channels |= channelBit(UploadChannel::Discord);
+    return channels;
+}
+
+ChannelMask uploadToChannels(std::string_view path, size_t size,
+                             ChannelMask channels) {
+    // Channels switched off by a config reload since the file was queued
+    // are done with it
+    const ChannelMask skipped = channels & ~uploadEnabledChannels();
+    channels &= ~skipped;
+
+    // Videos over a channel's video_part_size go to it in parts, after the
+    // channels that take them whole
+    ChannelMask parted = 0;
+    size_t partSizes[UPLOAD_CHANNEL_COUNT] = {};
+    if (isVideoFile(path)) {
+        for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+            const auto channel = static_cast<UploadChannel>(i);
+            if (!(channels & channelBit(channel))) continue;
+            partSizes[i] = videoPartSize(channel, size);
+            if (partSizes[i] > 0) parted |= channelBit(channel);
+        }
+    }
+
+    ChannelMask succeeded = skipped;
+    if (channels & ~parted) {
+        succeeded |= uploadWhole(path, size, channels & ~parted);
+    }
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        const auto channel = static_cast<UploadChannel>(i);
+        if ((parted & channelBit(channel)) &&
+            uploadParts(path, size, channel, partSizes[i])) {
+            succeeded |= channelBit(channel);
+        }
+    }
+    return succeeded;
+}
+
+void uploadBatch(BatchItem* items, size_t count) {
+    // Only screenshots with a regular album path go into the group; anything
+    // else (and a group too small to batch) is sent on its own
+    BatchItem* group[MAX_BATCH_SIZE];
+    size_t groupCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        BatchItem& item = items[i];
+        item.succeeded = 0;
+        if (groupCount < MAX_BATCH_SIZE && std::strlen(item.path) >= 36 &&
+            !isVideoFile(item.path)) {
+            group[groupCount++] = &item;
+        } else {
+            item.succeeded = uploadToChannels(item.path, item.size,
+                                              item.channels);
+        }
+    }
+    if (groupCount < 2) {
+        for (size_t i = 0; i < groupCount; ++i) {
+            group[i]->succeeded = uploadToChannels(
+                group[i]->path, group[i]->size, group[i]->channels);
+        }
+        return;
+    }
+
+    const ChannelMask channels = group[0]->channels;
+    constexpr ChannelMask batchable = channelBit(UploadChannel::Telegram) |
+                                      channelBit(UploadChannel::Discord);
+    ChannelMask skipped = channels & batchable & ~uploadEnabledChannels();
+    const ChannelMask active = channels & batchable & ~skipped;
+
+    SharedReader readers[MAX_BATCH_SIZE];
+    for (size_t i = 0; i < groupCount; ++i) {
+        readers[i].reset(group[i]->path, group[i]->size);
+    }
+    TranscodedFiles transcoded;
+
+    std::array<Transfer, MAX_TRANSFERS> transfers{};
+    size_t transferCount = 0;
+
+    const auto addTransfer = [&](UploadChannel channel, SetupResult result) {
+        if (result == SetupResult::Ready) {
+            ++transferCount;
+        } else if (result == SetupResult::Skip) {
+            skipped |= channelBit(channel);
+        }
+    };
+
+    if (active & channelBit(UploadChannel::Telegram)) {
+        const auto mode = Config::get().getTelegramUploadMode();
+        if (mode == UploadMode::Compressed || mode == UploadMode::Both) {
+            addTransfer(UploadChannel::Telegram,
+                        setupTelegramBatch(transfers[transferCount], readers,
+                                           transcoded, group, groupCount,
+                                           true));
+        }
+        if (mode == UploadMode::Original || mode == UploadMode::Both) {
+            addTransfer(UploadChannel::Telegram,
+                        setupTelegramBatch(transfers[transferCount], readers,
+                                           transcoded, group, groupCount,
+                                           false));
+        }
+    }
+    if (active & channelBit(UploadChannel::Discord)) {
+        addTransfer(UploadChannel::Discord,
+                    setupDiscordBatch(transfers[transferCount], readers,
+                                      transcoded, group, groupCount));
+    }
+
+    runTransfers(transfers.data(), transferCount);
+
+    const std::string label =
+        "batch of " + std::to_string(groupCount) + " files";
+    const size_t size = batchSize(group, groupCount);
+    ChannelMask delivered = skipped;
+    for (size_t i = 0; i < transferCount; ++i) {
+        if (finishTransfer(transfers[i], label, size)) {
+            delivered |= channelBit(transfers[i].channel);
+        }
+    }
+
+    // ntfy has no multi-file API, so it keeps one message per file
+    constexpr ChannelMask ntfy = channelBit(UploadChannel::Ntfy);
+    for (size_t i = 0; i < groupCount; ++i) {
+        group[i]->succeeded = delivered;
+        if (channels & ntfy) {
+            group[i]->succeeded |=
+                uploadToChannels(group[i]->path, group[i]->size, ntfy);
+        }
+    }
+}
+
+bool uploadInit() {
+    for (Mutex& lock : g_shareLocks) mutexInit(&lock);
+    g_share = createShare();
+    return g_share != nullptr;
+}
+
+ChannelMask uploadPrewarm(ChannelMask channels) {
+    ChannelMask warmed = 0;
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        const auto channel = static_cast<UploadChannel>(i);
+        if (!(channels & channelBit(channel))) continue;
+
+        std::string url;
+        switch (channel) {
+            case UploadChannel::Telegram:
+                url = Config::get().getTelegramApiUrl();
+                break;
+            case UploadChannel::Ntfy:
+                url = Config::get().getNtfyUrl();
+                break;
+            case UploadChannel::Discord:
+                url = Config::get().getDiscordApiUrl();
+                break;
+        }
+
+        CURL* curl = acquireHandle(channel);
+        if (!curl) continue;
+
+        // A HEAD request leaves the address, the TLS session and an idle
+        // connection in the share
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT,
+                         ImageTimeouts::connectTimeout);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, ImageTimeouts::connectTimeout);
+        const CURLcode res = curl_easy_perform(curl);
+        if (res == CURLE_OK) {
+            warmed |= channelBit(channel);
+            LOG_DEBUG() << "[" << channelName(channel) << "] Prewarmed "
+                        << url << endl;
+        } else {
+            LOG_DEBUG() << "[" << channelName(channel)
+                        << "] Prewarm failed: " << curl_easy_strerror(res)
+                        << " (code: " << res << ")" << endl;
+        }
+        // Like a failed upload: after a connection error the channel's
+        // first upload does not start on a dead connection or a stale
+        // address
+        releaseHandle(channel, 0, res);
+    }
+    return warmed;
+}
+
+void uploadCleanup() {
+    if (g_multi) {
+        curl_multi_cleanup(g_multi);
+        g_multi = nullptr;
+    }
+
+    for (auto& channelHandles : g_handles) {
+        for (CURL*& handle : channelHandles) {
+            if (handle) {
+                curl_easy_cleanup(handle);
+                handle = nullptr;
+            }
+        }
+    }
+    destroyShare();
+    // Nothing is connected any more
+    std::ranges::fill(g_connectionSendBuffer, 0L);
+    for (auto& channelFailed : g_connectionFailed) {
+        std::ranges::fill(channelFailed, false);
     }
 }
@@ -1,7 +1,37 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 
+// Upload channels, each backed by its own long-lived CURL handle
+enum class UploadChannel : uint8_t {
+    Telegram = 0,
+    Ntfy = 1,
+    Discord = 2,
+};
+
+constexpr size_t UPLOAD_CHANNEL_COUNT = 3;
+
+// Bitmask of UploadChannel values
+using ChannelMask = uint8_t;
+
+constexpr ChannelMask channelBit(UploadChannel channel) noexcept {
+    return static_cast<ChannelMask>(1u << static_cast<uint8_t>(channel));
+}
+
+constexpr std::string_view channelName(UploadChannel channel) noexcept {
+    switch (channel) {
+        case UploadChannel::Telegram:
+            return "Telegram";
+        case UploadChannel::Ntfy:
+            return "ntfy";
+        case UploadChannel::Discord:
+            return "Discord";
+    }
+    return "";
+}
+
 // Timeout configurations for images (screenshots)
 struct ImageTimeouts {
     static constexpr long connectTimeout = 10L;  // 10 seconds
@@ -18,6 +48,11 @@ struct VideoTimeouts {
     static constexpr int maxRetries = 3;
 };
 
+// Largest send buffer of an upload socket. networkUp() passes it to
+// socketInitialize() as tcp_tx_buf_max_size; the medium and large transfer
+// profiles use all of it.
+constexpr size_t SOCKET_SEND_BUFFER_MAX = 0x3000;  // 12KB
+
 // Check if file is a video based on extension
 inline bool isVideoFile(std::string_view path) {
     return (path.size() >= 4 && path.substr(path.size() - 4) == ".mp4");
@@ -39,12 +74,43 @@ inline int getMaxRetriesFromPath(std::string_view path) {
     return ImageTimeouts::maxRetries;
 }
 
-// Send file to Telegram with optional compression
-[[nodiscard]] bool sendFileToTelegram(std::string_view path, size_t size,
-                                      bool compression);
+// Mask of the channels enabled in the configuration
+[[nodiscard]] ChannelMask uploadEnabledChannels();
+
+// Upload a file to every channel in the mask at the same time, reading it
+// from storage only once. Returns the mask of channels that accepted it
+// (channels skipped per config count as delivered).
+[[nodiscard]] ChannelMask uploadToChannels(std::string_view path, size_t size,
+                                           ChannelMask channels);
+
+// Largest batch Telegram (sendMediaGroup) and Discord (attachments per
+// message) accept
+constexpr size_t MAX_BATCH_SIZE = 10;
+
+// One screenshot of a batched upload
+struct BatchItem {
+    const char* path;
+    size_t size;
+    ChannelMask channels;   // Channels to send to (same for every item)
+    ChannelMask succeeded;  // Set by uploadBatch()
+};
+
+// Upload several screenshots found in the same poll: one sendMediaGroup
+// request for Telegram and one multi-attachment message for Discord, while
+// ntfy (which has no multi-file API) still gets one request per file.
+// Fills every item's `succeeded` mask like uploadToChannels() returns it.
+void uploadBatch(BatchItem* items, size_t count);
+
+// Create the curl share object (DNS, TLS sessions, connections) used by
+// every upload handle. Call once after curl_global_init; uploads still work
+// without it, each handle then keeping its own caches.
+bool uploadInit();
 
-// Send file to ntfy.sh (always original, no compression)
-[[nodiscard]] bool sendFileToNtfy(std::string_view path, size_t size);
+// Resolve and connect to the API host of every channel in the mask so the
+// first upload finds its address, TLS session and connection cached.
+// Returns the channels that were reached.
+[[nodiscard]] ChannelMask uploadPrewarm(ChannelMask channels);
 
-// Send file to Discord (always original, no compression)
-[[nodiscard]] bool sendFileToDiscord(std::string_view path, size_t size);
+// Release all pooled CURL handles and the share object (must run before
+// curl_global_cleanup)
+void uploadCleanup();
@@ -0,0 +1,426 @@
+#include "worker.hpp"
+
+#include <switch.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include "activity.hpp"
+#include "config.hpp"
+#include "dedup.hpp"
+#include "health.hpp"
+#include "journal.hpp"
+#include "logger.hpp"
+#include "memory.hpp"
+#include "network.hpp"
+#include "preview.hpp"
+#include "queue.hpp"
+#include "retry.hpp"
+#include "stats.hpp"
+#include "upload.hpp"
+
+namespace {
+// The worker owns all network I/O (curl + TLS), so it needs more stack than
+// the detection loop; the buffer is static to keep it out of the heap.
+constexpr size_t UPLOAD_THREAD_STACK_SIZE = 0x20000;  // 128KB
+// Slightly below the main thread (49) so detection always gets to run
+constexpr int UPLOAD_THREAD_PRIORITY = 50;
+constexpr int UPLOAD_THREAD_CPU_ID = -2;  // Default core of the process
+// How often deferred videos check whether the game has been closed
+constexpr uint64_t VIDEO_DEFER_RECHECK_NS = 5'000'000'000ULL;
+// Connection prewarming after boot, while the network may still be coming up
+constexpr uint64_t PREWARM_RETRY_NS = 30'000'000'000ULL;
+constexpr int PREWARM_ATTEMPTS = 10;
+
+alignas(0x1000) u8 g_uploadThreadStack[UPLOAD_THREAD_STACK_SIZE];
+Thread g_uploadThread;
+
+// Channels with files that wait in the journal alone, and the paused ones
+// whose probe file has been taken out of it
+ChannelMask g_parkedChannels = 0;
+ChannelMask g_probingChannels = 0;
+
+// Leave work the retry queue cannot take now (its channel is paused, or the
+// queue is full) in the journal, which has no fixed limit, without spending
+// an attempt on it. resumeParked() takes it back out.
+void parkChannels(const char* filePath, ChannelMask channels,
+                  const uint8_t* attempts) {
+    if (channels == 0) return;
+    if (!journalPark(filePath, channels, attempts)) {
+        LOG_WARN() << "Journal cannot track " << filePath
+                   << " now, resuming it on the next start" << endl;
+        return;
+    }
+    g_parkedChannels |= channels;
+}
+
+// Hand the parked channels of a file back to the retry queue
+ChannelMask scheduleUnparked(const JournalEntry& entry) {
+    ChannelMask taken = 0;
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        const auto channel = static_cast<UploadChannel>(i);
+        if ((entry.pending & channelBit(channel)) &&
+            retryDefer(entry.filePath, entry.fileSize, channel,
+                       entry.attempts[i], 0)) {
+            taken |= channelBit(channel);
+        }
+    }
+    return taken;
+}
+
+// Take parked work back out of the journal: everything of the healthy
+// channels that fits into the retry queue, and a single file as the probe
+// of a paused channel whose cooldown has ended
+void resumeParked() {
+    if (g_parkedChannels == 0 || !retryHasRoom()) return;
+
+    const ChannelMask available = healthAvailableChannels();
+    const ChannelMask paused = healthPausedChannels();
+    // A probe ends once it has either resumed or paused its channel again
+    g_probingChannels &= available & paused;
+
+    const ChannelMask healthy = g_parkedChannels & available & ~paused;
+    const ChannelMask probe =
+        g_parkedChannels & available & paused & ~g_probingChannels;
+    if (healthy != 0) {
+        g_parkedChannels = journalUnpark(healthy, SIZE_MAX, scheduleUnparked);
+    }
+    if (probe != 0) {
+        g_parkedChannels = journalUnpark(probe, 1, scheduleUnparked);
+        g_probingChannels |= probe;
+    }
+}
+
+// Nanoseconds until a paused channel with parked files may be probed
+// (UINT64_MAX if there is none)
+uint64_t parkedProbeDelayNs() {
+    uint64_t delayNs = UINT64_MAX;
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        const auto channel = static_cast<UploadChannel>(i);
+        if (!(g_parkedChannels & channelBit(channel))) continue;
+
+        const uint64_t probeNs = healthProbeDelayNs(channel);
+        if (probeNs > 0) delayNs = std::min(delayNs, probeNs);
+    }
+    return delayNs;
+}
+
+// Hand every channel that did not take the file to the retry scheduler (or
+// give up once it is out of attempts) and journal the finished ones
+void settleUpload(const char* filePath, size_t fileSize, ChannelMask channels,
+                  ChannelMask delivered, const uint8_t* attempts) {
+    const int maxRetries = getMaxRetries(isVideoFile(filePath));
+    delivered &= channels;
+    const ChannelMask failed = channels & ~delivered;
+    // Channels this attempt paused wait for their probe instead
+    const ChannelMask paused = failed & ~healthAvailableChannels();
+    ChannelMask finished = delivered;
+    uint8_t parkedAttempts[UPLOAD_CHANNEL_COUNT];
+    std::copy_n(attempts, UPLOAD_CHANNEL_COUNT, parkedAttempts);
+    ChannelMask parked = paused;
+
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        const auto channel = static_cast<UploadChannel>(i);
+        if (!(failed & ~paused & channelBit(channel))) continue;
+
+        const int failures = attempts[i] + 1;
+        if (failures >= maxRetries) {
+            LOG_ERROR() << "[" << channelName(channel)
+                        << "] Upload failed after " << maxRetries << " attempts"
+                        << endl;
+            finished |= channelBit(channel);
+        } else if (retrySchedule(filePath, fileSize, channel, failures)) {
+            statsRecordRetry(channel);
+            LOG_INFO() << "[" << channelName(channel) << "] Retry " << failures
+                       << "/" << maxRetries << " in "
+                       << retryBackoffNs(failures) / 1'000'000'000ULL << "s"
+                       << endl;
+        } else {
+            LOG_WARN() << "[" << channelName(channel)
+                       << "] Retry queue full, leaving in journal: "
+                       << filePath << endl;
+            parkedAttempts[i] = static_cast<uint8_t>(failures);
+            parked |= channelBit(channel);
+        }
+    }
+
+    parkChannels(filePath, parked, parkedAttempts);
+    if (journalComplete(filePath, finished)) previewDelete(filePath);
+}
+
+// Last time the network was used, for the lazy_network idle teardown
+u64 g_lastNetworkTick = 0;
+
+// Bring the network up for a transfer; a failure counts as a failed
+// attempt on every channel
+bool ensureNetwork() {
+    g_lastNetworkTick = armGetSystemTick();
+    return networkUp();
+}
+
+// Channels of the mask the dedup index says already have this file, and
+// the key to record the outcome under (0 with skip_duplicates off)
+ChannelMask findDuplicates(const char* filePath, size_t fileSize,
+                           ChannelMask channels, DedupKey& key) {
+    key = Config::get().skipDuplicates() ? dedupKey(filePath, fileSize) : 0;
+    const ChannelMask duplicates = dedupDelivered(key) & channels;
+    for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+        const auto channel = static_cast<UploadChannel>(i);
+        if (duplicates & channelBit(channel)) {
+            LOG_INFO() << "[" << channelName(channel)
+                       << "] Already delivered, skipping: " << filePath
+                       << endl;
+        }
+    }
+    return duplicates;
+}
+
+// Send a file to the channels that do not have it yet and settle all of
+// them
+void deliverFile(const char* filePath, size_t fileSize, ChannelMask channels,
+                 const uint8_t* attempts, DedupKey key,
+                 ChannelMask duplicates) {
+    const ChannelMask missing = channels & ~duplicates;
+    ChannelMask delivered = 0;
+    if (missing != 0 && ensureNetwork()) {
+        MemoryScope scope(MemorySubsystem::Transfer);
+        delivered = uploadToChannels(filePath, fileSize, missing) & missing;
+    }
+    dedupRecord(key, delivered);
+    settleUpload(filePath, fileSize, channels, delivered | duplicates,
+                 attempts);
+    if (missing != 0) {
+        memoryLog("After upload", delivered != missing);
+    }
+}
+
+// Run one fan-out attempt for a single file, skipping paused channels
+void attemptUpload(const char* filePath, size_t fileSize, ChannelMask channels,
+                   const uint8_t* attempts) {
+    const ChannelMask paused = channels & ~healthAvailableChannels();
+    parkChannels(filePath, paused, attempts);
+    channels &= ~paused;
+    if (channels == 0) return;
+
+    DedupKey key;
+    const ChannelMask duplicates =
+        findDuplicates(filePath, fileSize, channels, key);
+    deliverFile(filePath, fileSize, channels, attempts, key, duplicates);
+}
+
+// Send screenshots from the same poll together; failures are retried
+// per file
+void attemptBatch(const UploadTask* tasks, size_t count) {
+    constexpr uint8_t noAttempts[UPLOAD_CHANNEL_COUNT] = {};
+
+    // Every task of a batch shares the same channels
+    const ChannelMask paused = tasks[0].channels & ~healthAvailableChannels();
+    const ChannelMask channels = tasks[0].channels & ~paused;
+
+    for (size_t i = 0; i < count; ++i) {
+        parkChannels(tasks[i].filePath, paused, noAttempts);
+    }
+    if (channels == 0) return;
+
+    // A file some channel already has leaves the batch, and is sent on its
+    // own to the rest
+    BatchItem items[MAX_BATCH_SIZE];
+    DedupKey keys[MAX_BATCH_SIZE];
+    size_t batched = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const UploadTask& task = tasks[i];
+        DedupKey key;
+        const ChannelMask duplicates =
+            findDuplicates(task.filePath, task.fileSize, channels, key);
+        if (duplicates != 0) {
+            deliverFile(task.filePath, task.fileSize, channels, noAttempts,
+                        key, duplicates);
+            continue;
+        }
+        keys[batched] = key;
+        items[batched++] = {task.filePath, task.fileSize, channels, 0};
+    }
+    if (batched == 0) return;
+
+    LOG_INFO() << "Uploading batch of " << batched << " screenshot(s)"
+               << endl;
+    if (ensureNetwork()) {
+        MemoryScope scope(MemorySubsystem::Transfer);
+        uploadBatch(items, batched);
+    }
+
+    bool failed = false;
+    for (size_t i = 0; i < batched; ++i) {
+        dedupRecord(keys[i], items[i].succeeded & channels);
+        settleUpload(items[i].path, items[i].size, items[i].channels,
+                     items[i].succeeded, noAttempts);
+        failed |= (items[i].succeeded & channels) != channels;
+    }
+    memoryLog("After batch upload", failed);
+}
+
+// Retry every (file, channel) pair whose backoff has expired
+void runDueRetries(bool deferVideos) {
+    RetryBatch batch;
+    while (retryTakeDue(batch)) {
+        if (deferVideos && isVideoFile(batch.filePath)) {
+            // Same attempt count, looked at again after the recheck delay
+            ChannelMask kept = 0;
+            for (size_t i = 0; i < UPLOAD_CHANNEL_COUNT; ++i) {
+                const auto channel = static_cast<UploadChannel>(i);
+                if ((batch.channels & channelBit(channel)) &&
+                    retryDefer(batch.filePath, batch.fileSize, channel,
+                               batch.attempts[i], VIDEO_DEFER_RECHECK_NS)) {
+                    kept |= channelBit(channel);
+                }
+            }
+            parkChannels(batch.filePath, batch.channels & ~kept,
+                         batch.attempts);
+            continue;
+        }
+        LOG_INFO() << "Retrying: " << batch.filePath << endl;
+        attemptUpload(batch.filePath, batch.fileSize, batch.channels,
+                      batch.attempts);
+    }
+}
+
+// Prewarm the channels not reached yet if the next attempt is due, and
+// return how long until the one after (UINT64_MAX when done)
+uint64_t prewarmIfDue(ChannelMask& pending, int& attempts, u64& lastTick) {
+    if (pending == 0 || attempts >= PREWARM_ATTEMPTS) return UINT64_MAX;
+
+    const u64 now = armGetSystemTick();
+    const uint64_t elapsedNs = armTicksToNs(now - lastTick);
+    if (attempts > 0 && elapsedNs < PREWARM_RETRY_NS) {
+        return PREWARM_RETRY_NS - elapsedNs;
+    }
+
+    ++attempts;
+    lastTick = now;
+    pending &= ~uploadPrewarm(pending);
+    if (pending != 0 && attempts < PREWARM_ATTEMPTS) return PREWARM_RETRY_NS;
+    return UINT64_MAX;
+}
+
+// With lazy_network, stop the network once it has been idle long enough,
+// and return how long until that is due (UINT64_MAX when it is down or
+// kept up)
+uint64_t networkDownIfIdle() {
+    const Config& config = Config::get();
+    if (!config.lazyNetwork() || !networkIsUp()) return UINT64_MAX;
+
+    const uint64_t idleTimeoutNs =
+        static_cast<uint64_t>(config.getNetworkIdleTimeoutSeconds()) *
+        1'000'000'000ULL;
+    const uint64_t idleNs =
+        armTicksToNs(armGetSystemTick() - g_lastNetworkTick);
+    if (idleNs < idleTimeoutNs) return idleTimeoutNs - idleNs;
+
+    LOG_INFO() << "[Network] Idle for " << idleNs / 1'000'000'000ULL
+               << "s, stopping" << endl;
+    networkDown();
+    memoryLog("Network stopped");
+    return UINT64_MAX;
+}
+
+void uploadThreadMain([[maybe_unused]] void* arg) {
+    constexpr uint8_t noAttempts[UPLOAD_CHANNEL_COUNT] = {};
+
+    // With lazy_network nothing is started before the first upload, so
+    // there is nothing to prewarm either
+    ChannelMask prewarmPending =
+        Config::get().lazyNetwork() ? 0 : uploadEnabledChannels();
+    int prewarmAttempts = 0;
+    u64 prewarmTick = 0;
+
+    while (true) {
+        // Between items: pick up a reloaded config.ini
+        Config::commitPending();
+        statsDumpIfDue();
+        Logger::get().flushIfDue();
+
+        // Without lazy_network the network stays up, also when the setting
+        // was just turned off; a failure is retried by the next upload
+        if (!Config::get().lazyNetwork() && !networkIsUp()) {
+            [[maybe_unused]] const bool up = ensureNetwork();
+        }
+
+        // Optionally keep videos back while a game is running
+        const bool deferVideos =
+            Config::get().deferVideosInGame() && isApplicationRunning();
+
+        // Fresh screenshots go ahead of due retries too, so a video failing
+        // on its backoff cannot hold them up either
+        if (queueLaneCount(QueueLane::Image) == 0) {
+            runDueRetries(deferVideos);
+        }
+
+        UploadTask tasks[MAX_BATCH_SIZE];
+        const size_t batchSize =
+            static_cast<size_t>(Config::get().getBatchSize());
+        const size_t count = queueGetBatch(tasks, batchSize, !deferVideos);
+        for (size_t i = 0; i < count; ++i) {
+            statsRecordDequeue(tasks[i].detectTick, tasks[i].enqueueTick);
+        }
+        if (count > 1) {
+            attemptBatch(tasks, count);
+            continue;
+        }
+        if (count == 1) {
+            const UploadTask& task = tasks[0];
+            const bool isVideo = isVideoFile(task.filePath);
+            LOG_INFO() << "Uploading: " << task.filePath << " ("
+                       << task.fileSize << " bytes, "
+                       << (isVideo ? "video" : "image") << ", max "
+                       << getMaxRetries(isVideo) << " retries)" << endl;
+
+            attemptUpload(task.filePath, task.fileSize, task.channels,
+                          noAttempts);
+            continue;
+        }
+
+        // Nothing queued: bring back parked work the retry queue has room
+        // for, then warm up the connections of channels that have not
+        // been reached since boot
+        resumeParked();
+        const uint64_t prewarmNs =
+            networkIsUp()
+                ? prewarmIfDue(prewarmPending, prewarmAttempts, prewarmTick)
+                : UINT64_MAX;
+        const uint64_t idleNs = networkDownIfIdle();
+        // Wake up for whatever this thread logged before going to sleep
+        const uint64_t logFlushNs = Logger::get().flushIfDue();
+
+        // Sleep until the detection loop queues something, the next retry
+        // is due or a channel with parked files may be probed; while videos
+        // are deferred, look again now and then to see whether the game has
+        // been closed
+        uint64_t timeoutNs = std::min({retryNextDueNs(), parkedProbeDelayNs(),
+                                       prewarmNs, idleNs, logFlushNs});
+        if (deferVideos) {
+            timeoutNs = std::min(timeoutNs, VIDEO_DEFER_RECHECK_NS);
+        }
+        [[maybe_unused]] const bool available =
+            queueWait(timeoutNs, !deferVideos);
+    }
+}
+}  // namespace
+
+bool uploadWorkerStart() {
+    Result rc = threadCreate(&g_uploadThread, uploadThreadMain, nullptr,
+                             g_uploadThreadStack, sizeof(g_uploadThreadStack),
+                             UPLOAD_THREAD_PRIORITY, UPLOAD_THREAD_CPU_ID);
+    if (R_FAILED(rc)) {
+        LOG_ERROR() << "threadCreate() failed: " << rc << endl;
+        return false;
+    }
+
+    rc = threadStart(&g_uploadThread);
+    if (R_FAILED(rc)) {
+        LOG_ERROR() << "threadStart() failed: " << rc << endl;
+        threadClose(&g_uploadThread);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Start the upload worker thread that drains the upload queue
+// Returns true if the thread is running
+[[nodiscard]] bool uploadWorkerStart();